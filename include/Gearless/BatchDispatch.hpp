@@ -0,0 +1,175 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#ifndef _BATCH_DISPATCH_HPP_
+#define _BATCH_DISPATCH_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#if defined(__SSSE3__) || defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+// Kernels that apply a next state lookup table to an array of state
+// indices, i.e. states[i] = next[states[i]]. The instruction set is picked
+// at compile time from the target macros of the compiler (-mssse3, -mavx2,
+// -mavx512f -mavx512bw or -march=native), with a scalar loop as fallback
+
+namespace Gearless
+{
+    ///==============================================================
+    ///= ShuffleLookup
+    ///==============================================================
+    // Byte shuffle lookup for machines with at most 16 states, where the
+    // whole column fits in one vector register. Returns how many states
+    // were processed, the remainder is left to the other kernels
+    template <class StateId>
+    inline std::size_t ShuffleLookup(StateId*, std::size_t, const StateId*, std::size_t)
+    {
+        return 0;
+    }
+
+    inline std::size_t ShuffleLookup(std::uint8_t* states, std::size_t n, const std::uint8_t* next, std::size_t stateCount)
+    {
+        std::size_t i = 0;
+#if defined(__SSSE3__)
+        if (stateCount > 16)
+            return 0;
+        const __m128i tbl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(next));
+#if defined(__AVX512BW__)
+        const __m512i tbl512 = _mm512_maskz_broadcast_i32x4(0xFFFF, tbl);
+        for (; i + 64 <= n; i += 64)
+        {
+            __m512i v = _mm512_loadu_si512(states + i);
+            _mm512_storeu_si512(states + i, _mm512_shuffle_epi8(tbl512, v));
+        }
+#endif
+#if defined(__AVX2__)
+        const __m256i tbl256 = _mm256_broadcastsi128_si256(tbl);
+        for (; i + 32 <= n; i += 32)
+        {
+            __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(states + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(states + i), _mm256_shuffle_epi8(tbl256, v));
+        }
+#endif
+        for (; i + 16 <= n; i += 16)
+        {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(states + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(states + i), _mm_shuffle_epi8(tbl, v));
+        }
+#else
+        (void) states; (void) n; (void) next; (void) stateCount;
+#endif
+        return i;
+    }
+
+    ///==============================================================
+    ///= GatherLookup
+    ///==============================================================
+    // Widens the state indices to 32 bits, gathers their next state from
+    // the widened column and narrows the result back. Returns how many
+    // states were processed, the remainder is left to the scalar loop
+#if defined(__AVX512F__)
+    // The zero masked forms are used throughout as the unmasked ones trip
+    // false maybe-uninitialized warnings in some compiler's intrinsic headers
+    inline __m512i LoadWide16(const std::uint8_t* p) { return _mm512_maskz_cvtepu8_epi32(0xFFFF, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p))); }
+    inline __m512i LoadWide16(const std::uint16_t* p) { return _mm512_maskz_cvtepu16_epi32(0xFFFF, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p))); }
+    inline __m512i LoadWide16(const std::uint32_t* p) { return _mm512_loadu_si512(p); }
+
+    inline void StoreNarrow16(std::uint8_t* p, __m512i v) { _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm512_maskz_cvtepi32_epi8(0xFFFF, v)); }
+    inline void StoreNarrow16(std::uint16_t* p, __m512i v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), _mm512_maskz_cvtepi32_epi16(0xFFFF, v)); }
+    inline void StoreNarrow16(std::uint32_t* p, __m512i v) { _mm512_storeu_si512(p, v); }
+#elif defined(__AVX2__)
+    inline __m256i LoadWide8(const std::uint8_t* p) { return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(p))); }
+    inline __m256i LoadWide8(const std::uint16_t* p) { return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))); }
+    inline __m256i LoadWide8(const std::uint32_t* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+
+    inline void StoreNarrow8(std::uint8_t* p, __m256i v)
+    {
+        // Pack to bytes within each 128 bit lane, then join the low dwords of both lanes
+        __m256i b = _mm256_packus_epi16(_mm256_packus_epi32(v, v), _mm256_packus_epi32(v, v));
+        __m128i joined = _mm_unpacklo_epi32(_mm256_castsi256_si128(b), _mm256_extracti128_si256(b, 1));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(p), joined);
+    }
+
+    inline void StoreNarrow8(std::uint16_t* p, __m256i v)
+    {
+        // Pack to words within each 128 bit lane, then move the low qword of the upper lane down
+        __m256i w = _mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), 0x08);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), _mm256_castsi256_si128(w));
+    }
+
+    inline void StoreNarrow8(std::uint32_t* p, __m256i v) { _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v); }
+#endif
+
+    template <class StateId>
+    inline std::size_t GatherLookup(StateId* states, std::size_t n, const std::int32_t* wide)
+    {
+        std::size_t i = 0;
+#if defined(__AVX512F__)
+        for (; i + 16 <= n; i += 16)
+        {
+            __m512i idx = LoadWide16(states + i);
+            StoreNarrow16(states + i, _mm512_mask_i32gather_epi32(_mm512_setzero_si512(), 0xFFFF, idx, wide, 4));
+        }
+#elif defined(__AVX2__)
+        for (; i + 8 <= n; i += 8)
+        {
+            __m256i idx = LoadWide8(states + i);
+            StoreNarrow8(states + i, _mm256_i32gather_epi32(reinterpret_cast<const int*>(wide), idx, 4));
+        }
+#else
+        (void) states; (void) n; (void) wide;
+#endif
+        return i;
+    }
+
+    // More than 2^32 states never occur in practice, keep them scalar
+    inline std::size_t GatherLookup(std::uint64_t*, std::size_t, const std::int32_t*)
+    {
+        return 0;
+    }
+
+    ///==============================================================
+    ///= GatherNextStates
+    ///==============================================================
+    // Replaces every state index with its entry in the given next state
+    // column, as laid out by NextStateColumn
+    template <class Column, class StateId>
+    inline void GatherNextStates(StateId* states, std::size_t n, std::size_t stateCount)
+    {
+        std::size_t i = ShuffleLookup(states, n, Column::next, stateCount);
+        i += GatherLookup(states + i, n - i, Column::wide);
+        for (; i < n; ++i)
+            states[i] = Column::next[states[i]];
+    }
+}
+
+#endif // ! _BATCH_DISPATCH_HPP_
@@ -0,0 +1,91 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#ifndef _CLOCK_HPP_
+#define _CLOCK_HPP_
+
+#include <chrono>
+#include <cstdint>
+#if defined(__linux__)
+#include <time.h>
+#endif
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#include <x86intrin.h>
+#endif
+
+namespace Gearless
+{
+    ///==============================================================
+    ///= Clocks
+    ///==============================================================
+    // Sources of timestamps for latency measurements and traces. Only
+    // differences of timestamps taken on the same thread are meaningful
+    struct SteadyClock
+    {
+        /// Nanoseconds since an arbitrary point
+        static std::uint64_t Now() noexcept
+        {
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+    };
+
+#if defined(__linux__)
+    struct MonotonicRawClock
+    {
+        /// Nanoseconds since boot, free of NTP adjustments, read through the vDSO
+        static std::uint64_t Now() noexcept
+        {
+            timespec ts;
+            clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+            return static_cast<std::uint64_t>(ts.tv_sec) * 1000000000u + static_cast<std::uint64_t>(ts.tv_nsec);
+        }
+    };
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+    struct TscClock
+    {
+        /// Reference cycles of the time stamp counter. The read is not
+        /// serializing, which is precise enough for anything above a few
+        /// dozen cycles at a fraction of the cost of a fenced read
+        static std::uint64_t Now() noexcept { return __rdtsc(); }
+    };
+
+    /// The cheapest clock of the platform
+    using LatencyClock = TscClock;
+#elif defined(__linux__)
+    using LatencyClock = MonotonicRawClock;
+#else
+    using LatencyClock = SteadyClock;
+#endif
+}
+
+#endif // ! _CLOCK_HPP_
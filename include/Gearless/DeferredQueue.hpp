@@ -0,0 +1,253 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#ifndef _DEFERRED_QUEUE_HPP_
+#define _DEFERRED_QUEUE_HPP_
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <Gearless/Dispatch.hpp>
+#include <Gearless/TypeList.hpp>
+
+namespace Gearless
+{
+    ///==============================================================
+    ///= DeferredSlotLayout
+    ///==============================================================
+    // The size and alignment a slot needs to hold any of the given events
+    template <class Events>
+    struct DeferredSlotLayout
+    {
+        static constexpr std::size_t size = 1;
+        static constexpr std::size_t align = 1;
+    };
+
+    template <class Event, class... Rest>
+    struct DeferredSlotLayout<Packer<Event, Rest...>>
+    {
+        static constexpr std::size_t size = sizeof(Event) > DeferredSlotLayout<Packer<Rest...>>::size
+            ? sizeof(Event) : DeferredSlotLayout<Packer<Rest...>>::size;
+        static constexpr std::size_t align = alignof(Event) > DeferredSlotLayout<Packer<Rest...>>::align
+            ? alignof(Event) : DeferredSlotLayout<Packer<Rest...>>::align;
+    };
+
+    ///==============================================================
+    ///= NoDeferredQueue
+    ///==============================================================
+    // Stands in for the queue of machines that defer nothing, so that it
+    // costs nothing as a base class
+    struct NoDeferredQueue
+    {
+        template <class Event>
+        bool Push(const Event&) noexcept { return false; }
+
+        template <class Machine>
+        void Replay(Machine&) {}
+
+        void Clear() noexcept {}
+
+        std::size_t Size() const noexcept { return 0; }
+    };
+
+    ///==============================================================
+    ///= DeferredQueue
+    ///==============================================================
+    // Fixed capacity ring of the events deferred by a machine, in arrival
+    // order. Events are type erased into inline slots sized for the largest
+    // deferred event type of the machine, so deferring never allocates.
+    // Each slot only adds a pointer to the static operations of its type.
+    // Replaying goes through the Dispatch(ev, enqueue) member of the Machine,
+    // which is expected to befriend the queue
+    template <class Model, class Machine, std::size_t Capacity>
+    class DeferredQueue
+    {
+        static_assert(Capacity >= 1 && (Capacity & (Capacity - 1)) == 0, "Deferred queue capacity must be a power of two");
+
+        using StateId = typename Model::StateId;
+        using Layout = DeferredSlotLayout<typename Model::DeferredEvents>;
+
+        public:
+            DeferredQueue() noexcept : mHead(0), mSize(0) {}
+            ~DeferredQueue() { Clear(); }
+
+            DeferredQueue(const DeferredQueue&) = delete;
+            DeferredQueue& operator=(const DeferredQueue&) = delete;
+
+            /// Takes over the queued events of the other queue, leaving it empty
+            DeferredQueue(DeferredQueue&& other);
+
+            /// Appends a copy of the event. Returns false if the queue is full
+            template <class Event>
+            bool Push(const Event& ev);
+
+            /// Dispatches the queued events again in arrival order, keeping the ones
+            /// that are still deferred. Every state change restarts from the oldest
+            /// event, until none of the remaining ones is handled
+            void Replay(Machine& machine);
+
+            /// Destroys every queued event
+            void Clear() noexcept;
+
+            /// Number of queued events
+            std::size_t Size() const noexcept { return mSize; }
+
+        private:
+            struct Operations
+            {
+                /// Dispatches the event and returns whether it was deferred again
+                bool (*dispatch)(Machine&, const void*);
+
+                /// Move constructs the event into raw storage and destroys the source
+                void (*relocate)(void*, void*);
+
+                void (*destroy)(void*);
+            };
+
+            template <class Event>
+            struct OperationsOf
+            {
+                static bool Dispatch(Machine& machine, const void* p)
+                {
+                    return machine.Dispatch(*static_cast<const Event*>(p), false) == EventResult::Deferred;
+                }
+
+                static void Relocate(void* dst, void* src)
+                {
+                    Event* ev = static_cast<Event*>(src);
+                    ::new (dst) Event(std::move(*ev));
+                    ev->~Event();
+                }
+
+                static void Destroy(void* p) { static_cast<Event*>(p)->~Event(); }
+
+                static const Operations ops;
+            };
+
+            struct Slot
+            {
+                const Operations* ops;
+                typename std::aligned_storage<Layout::size, Layout::align>::type storage;
+            };
+
+            static constexpr std::size_t Mask = Capacity - 1;
+
+            Slot& At(std::size_t i) noexcept { return mSlots[(mHead + i) & Mask]; }
+
+            /// Destroys the event at the given position and closes the gap
+            void Erase(std::size_t i);
+
+            Slot mSlots[Capacity];
+            std::size_t mHead;
+            std::size_t mSize;
+    };
+
+    template <class Model, class Machine, std::size_t Capacity>
+    template <class Event>
+    const typename DeferredQueue<Model, Machine, Capacity>::Operations DeferredQueue<Model, Machine, Capacity>::OperationsOf<Event>::ops = {
+        &OperationsOf<Event>::Dispatch, &OperationsOf<Event>::Relocate, &OperationsOf<Event>::Destroy
+    };
+
+    template <class Model, class Machine, std::size_t Capacity>
+    inline DeferredQueue<Model, Machine, Capacity>::DeferredQueue(DeferredQueue&& other) : mHead(0), mSize(0)
+    {
+        for (; mSize < other.mSize; ++mSize)
+        {
+            Slot& from = other.At(mSize);
+            from.ops->relocate(&mSlots[mSize].storage, &from.storage);
+            mSlots[mSize].ops = from.ops;
+        }
+        other.mHead = 0;
+        other.mSize = 0;
+    }
+
+    template <class Model, class Machine, std::size_t Capacity>
+    template <class Event>
+    inline bool DeferredQueue<Model, Machine, Capacity>::Push(const Event& ev)
+    {
+        static_assert(sizeof(Event) <= Layout::size && alignof(Event) <= Layout::align,
+                      "Only the events named in the deferrals of the machine can be deferred");
+
+        if (mSize == Capacity)
+            return false;
+        Slot& slot = At(mSize);
+        ::new (&slot.storage) Event(ev);
+        slot.ops = &OperationsOf<Event>::ops;
+        ++mSize;
+        return true;
+    }
+
+    template <class Model, class Machine, std::size_t Capacity>
+    inline void DeferredQueue<Model, Machine, Capacity>::Replay(Machine& machine)
+    {
+        for (std::size_t i = 0; i < mSize;)
+        {
+            Slot& slot = At(i);
+            const StateId before = machine.GetState();
+            if (slot.ops->dispatch(machine, &slot.storage))
+            {
+                ++i;
+                continue;
+            }
+            Erase(i);
+            // Events kept earlier may no longer be deferred in the new state
+            if (machine.GetState() != before)
+                i = 0;
+        }
+    }
+
+    template <class Model, class Machine, std::size_t Capacity>
+    inline void DeferredQueue<Model, Machine, Capacity>::Erase(std::size_t i)
+    {
+        At(i).ops->destroy(&At(i).storage);
+        if (i == 0)
+            mHead = (mHead + 1) & Mask;
+        else
+        {
+            for (; i + 1 < mSize; ++i)
+            {
+                At(i + 1).ops->relocate(&At(i).storage, &At(i + 1).storage);
+                At(i).ops = At(i + 1).ops;
+            }
+        }
+        --mSize;
+    }
+
+    template <class Model, class Machine, std::size_t Capacity>
+    inline void DeferredQueue<Model, Machine, Capacity>::Clear() noexcept
+    {
+        for (; mSize != 0; --mSize, mHead = (mHead + 1) & Mask)
+            At(0).ops->destroy(&At(0).storage);
+        mHead = 0;
+    }
+}
+
+#endif // ! _DEFERRED_QUEUE_HPP_
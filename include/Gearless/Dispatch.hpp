@@ -0,0 +1,466 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#ifndef _DISPATCH_HPP_
+#define _DISPATCH_HPP_
+
+#include <algorithm>
+#include <cstdint>
+#include <Gearless/TypeId.hpp>
+#include <Gearless/TypeList.hpp>
+
+namespace Gearless
+{
+    ///==============================================================
+    ///= SmallestUInt
+    ///==============================================================
+    // The narrowest unsigned integer type able to represent MaxValue
+    template <std::size_t MaxValue>
+    struct SmallestUInt
+    {
+        using type =
+            typename std::conditional<MaxValue <= UINT8_MAX, std::uint8_t,
+            typename std::conditional<MaxValue <= UINT16_MAX, std::uint16_t,
+            typename std::conditional<MaxValue <= UINT32_MAX, std::uint32_t,
+                std::uint64_t>::type>::type>::type;
+    };
+
+    ///==============================================================
+    ///= EventResult
+    ///==============================================================
+    // What became of a dispatched event
+    enum class EventResult : std::uint8_t
+    {
+        /// A transition fired
+        Handled,
+
+        /// No transition of the current state accepted the event
+        Unhandled,
+
+        /// The current state deferred the event
+        Deferred
+    };
+
+    ///==============================================================
+    ///= JumpTable
+    ///==============================================================
+    // The transitions of a table in declaration order, as indices into its
+    // States and Events. Compile time computations over them read counts as
+    // PackSize<...>::value and sizeof..., never as the static members below,
+    // whose reads cost the compiler time linear in the length of the table
+    template <class States, class Events, class... Transitions>
+    struct JumpTableKeys
+    {
+        static constexpr std::size_t StateCount = PackSize<States>::value;
+        static constexpr std::size_t EventCount = PackSize<Events>::value;
+        static constexpr std::size_t RowCount = sizeof...(Transitions);
+
+        struct Key
+        {
+            std::size_t state;
+            std::size_t event;
+
+            /// The state the transition leads to
+            std::size_t next;
+        };
+
+        /// The (state, event) pair of every transition in declaration order
+        static constexpr ConstArray<Key, sizeof...(Transitions)> Make()
+        {
+            return {{
+                Key{TypeIndex<typename Transitions::PrevState, States>::value,
+                    TypeIndex<typename Transitions::Event, Events>::value,
+                    TypeIndex<typename Transitions::NextState, States>::value}...
+            }};
+        }
+
+        /// The (state, event) pair of the given row along with its next state
+        static constexpr Key KeyAt(std::size_t row) { return ConstTable<JumpTableKeys>::table.values[row]; }
+
+        /// The (state, event) pair of the given row flattened into one cell index
+        static constexpr std::size_t KeyOf(std::size_t row) { return KeyAt(row).state * PackSize<Events>::value + KeyAt(row).event; }
+    };
+
+    template <class States, class Events, class... Transitions>
+    constexpr std::size_t JumpTableKeys<States, Events, Transitions...>::StateCount;
+
+    template <class States, class Events, class... Transitions>
+    constexpr std::size_t JumpTableKeys<States, Events, Transitions...>::EventCount;
+
+    template <class States, class Events, class... Transitions>
+    constexpr std::size_t JumpTableKeys<States, Events, Transitions...>::RowCount;
+
+    // Sort keys grouping the rows of a table by event
+    template <class Keys>
+    struct EventKeys
+    {
+        static constexpr std::size_t RowCount = Keys::RowCount;
+        static constexpr std::size_t KeyOf(std::size_t row) { return Keys::KeyAt(row).event; }
+    };
+
+    template <class Keys>
+    constexpr std::size_t EventKeys<Keys>::RowCount;
+
+    // Sorted position of the first row of every Stride-th key, that is of
+    // every state for the rows sorted by (state, event) key
+    template <class Sorted, std::size_t Stride, class Seq>
+    struct SortedRunStarts;
+
+    template <class Sorted, std::size_t Stride, std::size_t... Ks>
+    struct SortedRunStarts<Sorted, Stride, IndexSeq<Ks...>>
+    {
+        static constexpr ConstArray<std::size_t, sizeof...(Ks)> Make() { return {{ Sorted::Start(Ks * Stride)... }}; }
+    };
+
+    template <class States, class Events, class... Transitions>
+    struct JumpTableRows : JumpTableKeys<States, Events, Transitions...>
+    {
+        using Keys = JumpTableKeys<States, Events, Transitions...>;
+        using Keys::StateCount;
+        using Keys::EventCount;
+        using Keys::RowCount;
+        using Keys::KeyAt;
+        using Keys::KeyOf;
+
+        /// Cells hold the index of the transition to fire or RowCount if there is none
+        using Cell = typename SmallestUInt<RowCount>::type;
+
+        /// The rows ordered by (state, event) key, in declaration order among the rows of a key
+        using Sorted = SortedRows<Keys>;
+
+        /// The rows ordered by event, in declaration order among the rows of an event
+        using ByEvent = SortedRows<EventKeys<Keys>>;
+
+        /// Returns the first row declared for the given pair or RowCount if there is none.
+        /// Only the rows of the given state are searched, whose bounds are found once per
+        /// state, so filling the StateCount x EventCount cells costs O(S log T) for the
+        /// bounds and then a search over the handful of rows of its state per cell
+        static constexpr std::size_t Find(std::size_t state, std::size_t event)
+        {
+            return FirstOf(state * PackSize<Events>::value + event, Sorted::LowerBound(
+                (state * PackSize<Events>::value + event) * sizeof...(Transitions), StateStart(state), StateStart(state + 1)));
+        }
+
+        /// Computes the cell at the given flattened (state * EventCount + event) position
+        static constexpr Cell CellAt(std::size_t i)
+        {
+            return static_cast<Cell>(Find(i / PackSize<Events>::value, i % PackSize<Events>::value));
+        }
+
+        /// Computes the state reached from the given one on the given event, which is
+        /// the state itself when nothing fires and 0 for padding past the last state
+        static constexpr std::size_t NextState(std::size_t state, std::size_t event)
+        {
+            return state >= PackSize<States>::value ? 0 : NextOf(state, Find(state, event));
+        }
+
+        private:
+            using StateStarts = SortedRunStarts<Sorted, PackSize<Events>::value,
+                typename MakeIndexSeq<PackSize<States>::value + 1>::type>;
+
+            static constexpr std::size_t StateStart(std::size_t state) { return ConstTable<StateStarts>::table.values[state]; }
+
+            /// The row at the given sorted position if it has the given key, RowCount otherwise
+            static constexpr std::size_t FirstOf(std::size_t key, std::size_t pos)
+            {
+                return pos < sizeof...(Transitions) && KeyOf(Sorted::RowAt(pos)) == key ? Sorted::RowAt(pos) : sizeof...(Transitions);
+            }
+
+            static constexpr std::size_t NextOf(std::size_t state, std::size_t row)
+            {
+                return row == sizeof...(Transitions) ? state : KeyAt(row).next;
+            }
+    };
+
+    // The rows triggered by the given event, in declaration order
+    template <class Rows, std::size_t Event>
+    struct EventRowIndices
+    {
+        using type = typename SortedRowRange<typename Rows::ByEvent, Rows::ByEvent::Start(Event),
+            typename MakeIndexSeq<Rows::ByEvent::Start(Event + 1) - Rows::ByEvent::Start(Event)>::type>::type;
+    };
+
+    // The rows declared after the given one for the same (state, event) pair, in declaration order
+    template <class Rows, std::size_t Row,
+              std::size_t First = Rows::Sorted::PositionOf(Rows::KeyOf(Row), Row) + 1>
+    struct LaterRowIndices
+    {
+        using type = typename SortedRowRange<typename Rows::Sorted, First,
+            typename MakeIndexSeq<Rows::Sorted::Start(Rows::KeyOf(Row) + 1) - First>::type>::type;
+    };
+
+    template <class Rows, class Seq>
+    struct JumpTableCells;
+
+    template <class Rows, std::size_t... Is>
+    struct JumpTableCells<Rows, IndexSeq<Is...>>
+    {
+        using Cell = typename Rows::Cell;
+        static constexpr Cell cells[Rows::StateCount][Rows::EventCount] = { Rows::CellAt(Is)... };
+    };
+
+    template <class Rows, std::size_t... Is>
+    constexpr typename JumpTableCells<Rows, IndexSeq<Is...>>::Cell
+        JumpTableCells<Rows, IndexSeq<Is...>>::cells[Rows::StateCount][Rows::EventCount];
+
+    ///==============================================================
+    ///= NextStateColumn
+    ///==============================================================
+    // The next state of every state for one event, as a flat lookup table.
+    // It is padded to at least 16 entries so that it can be fed to vector
+    // shuffles, and also kept widened to 32 bits for vector gathers
+    template <class Rows, class StateId, std::size_t Event, class Seq>
+    struct NextStateColumn;
+
+    template <class Rows, class StateId, std::size_t Event, std::size_t... Is>
+    struct NextStateColumn<Rows, StateId, Event, IndexSeq<Is...>>
+    {
+        static constexpr std::size_t Size = sizeof...(Is);
+        alignas(64) static constexpr StateId next[Size] = { static_cast<StateId>(Rows::NextState(Is, Event))... };
+        alignas(64) static constexpr std::int32_t wide[Size] = { static_cast<std::int32_t>(Rows::NextState(Is, Event))... };
+    };
+
+    template <class Rows, class StateId, std::size_t Event, std::size_t... Is>
+    constexpr StateId NextStateColumn<Rows, StateId, Event, IndexSeq<Is...>>::next[];
+
+    template <class Rows, class StateId, std::size_t Event, std::size_t... Is>
+    constexpr std::int32_t NextStateColumn<Rows, StateId, Event, IndexSeq<Is...>>::wide[];
+
+    ///==============================================================
+    ///= SubTable
+    ///==============================================================
+    template <std::size_t State, std::size_t Row>
+    struct SubTableEntry {};
+
+    // The (state, row) pairs of one event in ascending state order
+    template <class Rows, std::size_t Event, class Seq>
+    struct SubTableEntries;
+
+    template <class Rows, std::size_t Event, std::size_t... Ss>
+    struct SubTableEntries<Rows, Event, IndexSeq<Ss...>>
+    {
+        using type = typename PackConcat<
+            typename std::conditional<
+                Rows::Find(Ss, Event) != Rows::RowCount,
+                Packer<SubTableEntry<Ss, Rows::Find(Ss, Event)>>,
+                Packer<>
+            >::type...
+        >::type;
+    };
+
+    // The ((state, event) key, row) pairs of one state in ascending event order
+    template <class Rows, std::size_t State, class Seq>
+    struct SortedStateEntries;
+
+    template <class Rows, std::size_t State, std::size_t... Es>
+    struct SortedStateEntries<Rows, State, IndexSeq<Es...>>
+    {
+        using type = typename PackConcat<
+            typename std::conditional<
+                Rows::Find(State, Es) != Rows::RowCount,
+                Packer<SubTableEntry<State * Rows::EventCount + Es, Rows::Find(State, Es)>>,
+                Packer<>
+            >::type...
+        >::type;
+    };
+
+    // The ((state, event) key, row) pairs of every handled pair in ascending key order
+    template <class Rows, class Seq>
+    struct SortedEntries;
+
+    template <class Rows, std::size_t... Ss>
+    struct SortedEntries<Rows, IndexSeq<Ss...>>
+    {
+        using type = typename PackConcat<
+            typename SortedStateEntries<Rows, Ss, typename MakeIndexSeq<Rows::EventCount>::type>::type...
+        >::type;
+    };
+
+    // Sorted array of lookup keys along with the transition each of them fires
+    template <class Key, class RowId, class Entries>
+    struct SubTable;
+
+    template <class Key, class RowId, std::size_t... Ks, std::size_t... Rs>
+    struct SubTable<Key, RowId, Packer<SubTableEntry<Ks, Rs>...>>
+    {
+        static constexpr std::size_t Size = sizeof...(Ks);
+        static constexpr Key keys[Size] = { static_cast<Key>(Ks)... };
+        static constexpr RowId rows[Size] = { static_cast<RowId>(Rs)... };
+
+        /// Returns the row stored for the given key or none if there is no such row
+        static std::size_t Find(Key key, std::size_t none)
+        {
+            // A short scan beats the branchy binary search on a handful of entries
+            if (Size <= 8)
+            {
+                for (std::size_t i = 0; i < Size; ++i)
+                    if (keys[i] == key)
+                        return rows[i];
+                return none;
+            }
+            const Key* it = std::lower_bound(keys, keys + Size, key);
+            return it != keys + Size && *it == key ? rows[it - keys] : none;
+        }
+    };
+
+    template <class Key, class RowId, std::size_t... Ks, std::size_t... Rs>
+    constexpr Key SubTable<Key, RowId, Packer<SubTableEntry<Ks, Rs>...>>::keys[];
+
+    template <class Key, class RowId, std::size_t... Ks, std::size_t... Rs>
+    constexpr RowId SubTable<Key, RowId, Packer<SubTableEntry<Ks, Rs>...>>::rows[];
+
+    ///==============================================================
+    ///= StateSwitch
+    ///==============================================================
+    // Compare and branch cascade on the current state over the rows of one
+    // event. GCC keeps it as one compare per row rather than a jump table,
+    // so it costs O(k) for the k states handling the event
+    template <class States, class Rows>
+    struct StateSwitch
+    {
+        static std::size_t Find(std::size_t, std::size_t none) { return none; }
+    };
+
+    template <class States, class Row, class... Rest>
+    struct StateSwitch<States, Packer<Row, Rest...>>
+    {
+        static std::size_t Find(std::size_t state, std::size_t none)
+        {
+            return state == TypeIndex<typename Row::type::PrevState, States>::value
+                ? Row::index
+                : StateSwitch<States, Packer<Rest...>>::Find(state, none);
+        }
+    };
+
+    ///==============================================================
+    ///= LinearDispatch
+    ///==============================================================
+    // Scans the (state, event) keys of every transition in declaration order.
+    // No extra tables at all, for tiny machines or as a reference
+    struct LinearDispatch
+    {
+        template <class Model, class Event>
+        static std::size_t Find(typename Model::StateId state)
+        {
+            using Rows = typename Model::Rows;
+            const std::size_t event = Model::template EventIndex<Event>();
+            for (std::size_t i = 0; i < Rows::RowCount; ++i)
+                if (Rows::KeyAt(i).state == state && Rows::KeyAt(i).event == event)
+                    return i;
+            return Model::TransitionCount;
+        }
+    };
+
+    ///==============================================================
+    ///= SwitchDispatch
+    ///==============================================================
+    // Compares the current state with every state handling the event in
+    // turn. Needs no data tables and only ever touches code, which makes it
+    // a good fit for events handled in a handful of states
+    struct SwitchDispatch
+    {
+        template <class Model, class Event>
+        static std::size_t Find(typename Model::StateId state)
+        {
+            using Switch = StateSwitch<typename Model::States, typename Model::template EventRows<Event>>;
+            return Switch::Find(state, Model::TransitionCount);
+        }
+    };
+
+    ///==============================================================
+    ///= DenseDispatch
+    ///==============================================================
+    // Looks the transition up in the [state][event] jump table of the model.
+    // One indexed load per event, at the cost of StateCount x EventCount cells
+    struct DenseDispatch
+    {
+        template <class Model, class Event>
+        static std::size_t Find(typename Model::StateId state)
+        {
+            return Model::Cells::cells[state][Model::template EventIndex<Event>()];
+        }
+    };
+
+    ///==============================================================
+    ///= SortedDispatch
+    ///==============================================================
+    // Binary searches one array holding the handled (state, event) pairs of
+    // the whole machine sorted by key. Memory is proportional to the
+    // transition count, lookups take O(log n) over all the n handled pairs
+    struct SortedDispatch
+    {
+        template <class Model>
+        using Table = SubTable<
+            typename SmallestUInt<Model::StateCount * Model::EventCount>::type,
+            typename Model::Rows::Cell,
+            typename SortedEntries<
+                typename Model::Rows,
+                typename MakeIndexSeq<Model::StateCount>::type
+            >::type
+        >;
+
+        template <class Model, class Event>
+        static std::size_t Find(typename Model::StateId state)
+        {
+            using Key = typename SmallestUInt<Model::StateCount * Model::EventCount>::type;
+            const Key key = static_cast<Key>(state * Model::EventCount + Model::template EventIndex<Event>());
+            return Table<Model>::Find(key, Model::TransitionCount);
+        }
+    };
+
+    ///==============================================================
+    ///= SparseDispatch
+    ///==============================================================
+    // Looks the transition up in a sorted sub-table holding only the states
+    // that handle the event. Memory is proportional to the transition count
+    // and lookups take O(log k) for the k states handling the event, which
+    // suits machines with many states but sparse event usage
+    struct SparseDispatch
+    {
+        template <class Model, class Event>
+        using Table = SubTable<
+            typename Model::StateId,
+            typename Model::Rows::Cell,
+            typename SubTableEntries<
+                typename Model::Rows,
+                Model::template EventIndex<Event>(),
+                typename MakeIndexSeq<Model::StateCount>::type
+            >::type
+        >;
+
+        template <class Model, class Event>
+        static std::size_t Find(typename Model::StateId state)
+        {
+            return Table<Model, Event>::Find(state, Model::TransitionCount);
+        }
+    };
+}
+
+#endif // ! _DISPATCH_HPP_
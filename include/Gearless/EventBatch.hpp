@@ -0,0 +1,220 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#ifndef _EVENT_BATCH_HPP_
+#define _EVENT_BATCH_HPP_
+
+#include <cassert>
+#include <cstdint>
+#include <tuple>
+#include <vector>
+#include <Gearless/StateMachine.hpp>
+
+namespace Gearless
+{
+    ///==============================================================
+    ///= EventBatch
+    ///==============================================================
+    // A batch of events of mixed types addressed to machines of the same
+    // model. Payloads are stored per event type, so applying the batch
+    // runs one typed dispatch loop per event type instead of paying the
+    // event lookup once per event
+    template <class Model>
+    class EventBatch
+    {
+        public:
+            /// Identifies the target machine by its position in the machine array
+            using Handle = std::size_t;
+
+            /// Appends an event for the given machine, events unknown to the model
+            /// are dropped at compile time
+            template <class Event>
+            void Post(Handle h, const Event& ev);
+
+            /// Retrieves the number of events in the batch
+            std::size_t Size() const noexcept { return mRecords.size(); }
+
+            /// Removes every event from the batch, keeping the allocated storage
+            void Clear();
+
+            /// Dispatches every event of the batch to its machine in the given state
+            /// array, which must hold a state for every posted handle. Events for the
+            /// same machine are applied in the order they were posted, events for
+            /// different machines are grouped by type
+            template <class StateId>
+            void Apply(StateId* states, std::size_t machineCount);
+
+        private:
+            template <class Pack>
+            struct PayloadStorage;
+
+            template <class... Events>
+            struct PayloadStorage<Packer<Events...>>
+            {
+                using type = std::tuple<std::vector<Events>...>;
+            };
+
+            struct Record
+            {
+                Handle handle;
+                std::uint32_t event;
+                std::uint32_t slot;
+            };
+
+            template <class Event>
+            void Post(Handle h, const Event& ev, std::true_type);
+
+            template <class Event>
+            void Post(Handle, const Event&, std::false_type) {}
+
+            template <std::size_t... Is>
+            void ClearPayloads(IndexSeq<Is...>);
+
+            template <class StateId, class Event>
+            static void DispatchBucket(StateId* states, const Record* records, std::size_t n, const EventBatch& batch);
+
+            template <class StateId, class Events>
+            struct BucketDispatchers;
+
+            template <class StateId, class... Events>
+            struct BucketDispatchers<StateId, Packer<Events...>>
+            {
+                using BucketFn = void (*)(StateId*, const Record*, std::size_t, const EventBatch&);
+
+                /// One typed loop per event type, indexed by event
+                static constexpr BucketFn dispatchers[sizeof...(Events)] = { &EventBatch::DispatchBucket<StateId, Events>... };
+            };
+
+            /// The events in posting order
+            std::vector<Record> mRecords;
+
+            /// The event payloads, one vector per event type of the model
+            typename PayloadStorage<typename Model::Events>::type mPayloads;
+
+            /// Scratch space reused between Apply calls
+            std::vector<std::uint32_t> mRounds;
+            std::vector<std::uint32_t> mSeen;
+            std::vector<std::size_t> mBucketStarts;
+            std::vector<std::size_t> mCursors;
+            std::vector<Record> mSorted;
+    };
+
+    template <class Model>
+    template <class Event>
+    inline void EventBatch<Model>::Post(Handle h, const Event& ev)
+    {
+        Post(h, ev, PackContains<Event, typename Model::Events>());
+    }
+
+    template <class Model>
+    template <class Event>
+    inline void EventBatch<Model>::Post(Handle h, const Event& ev, std::true_type)
+    {
+        std::vector<Event>& payloads = std::get<Model::template EventIndex<Event>()>(mPayloads);
+        mRecords.push_back(Record{h,
+                                  static_cast<std::uint32_t>(Model::template EventIndex<Event>()),
+                                  static_cast<std::uint32_t>(payloads.size())});
+        payloads.push_back(ev);
+    }
+
+    template <class Model>
+    inline void EventBatch<Model>::Clear()
+    {
+        mRecords.clear();
+        ClearPayloads(typename MakeIndexSeq<Model::EventCount>::type());
+    }
+
+    template <class Model>
+    template <std::size_t... Is>
+    inline void EventBatch<Model>::ClearPayloads(IndexSeq<Is...>)
+    {
+        int expand[] = { 0, (std::get<Is>(mPayloads).clear(), 0)... };
+        (void) expand;
+    }
+
+    template <class Model>
+    template <class StateId>
+    inline void EventBatch<Model>::Apply(StateId* states, std::size_t machineCount)
+    {
+        const std::size_t eventCount = Model::EventCount;
+
+        // The round of an event is the number of earlier events of its machine.
+        // All events of one round target distinct machines, so within a round
+        // they can be reordered freely, while rounds run one after the other
+        mSeen.resize(machineCount, 0);
+        mRounds.resize(mRecords.size());
+        std::uint32_t roundCount = 0;
+        for (std::size_t i = 0; i < mRecords.size(); ++i)
+        {
+            assert(mRecords[i].handle < machineCount && "Event posted to a handle outside of the machine array");
+            std::uint32_t round = mSeen[mRecords[i].handle]++;
+            mRounds[i] = round;
+            roundCount = round + 1 > roundCount ? round + 1 : roundCount;
+        }
+        for (const Record& r : mRecords)
+            mSeen[r.handle] = 0;
+
+        // Counting sort by (round, event) keeps posting order within each bucket
+        mBucketStarts.assign(roundCount * eventCount + 1, 0);
+        for (std::size_t i = 0; i < mRecords.size(); ++i)
+            ++mBucketStarts[mRounds[i] * eventCount + mRecords[i].event + 1];
+        for (std::size_t b = 1; b < mBucketStarts.size(); ++b)
+            mBucketStarts[b] += mBucketStarts[b - 1];
+        mSorted.resize(mRecords.size());
+        mCursors.assign(mBucketStarts.begin(), mBucketStarts.end() - 1);
+        for (std::size_t i = 0; i < mRecords.size(); ++i)
+            mSorted[mCursors[mRounds[i] * eventCount + mRecords[i].event]++] = mRecords[i];
+
+        for (std::size_t b = 0; b + 1 < mBucketStarts.size(); ++b)
+        {
+            const std::size_t first = mBucketStarts[b], last = mBucketStarts[b + 1];
+            // One typed loop per event type, selected once per bucket
+            if (first != last)
+                BucketDispatchers<StateId, typename Model::Events>::dispatchers[b % eventCount](
+                    states, mSorted.data() + first, last - first, *this);
+        }
+    }
+
+    template <class Model>
+    template <class StateId, class Event>
+    inline void EventBatch<Model>::DispatchBucket(StateId* states, const Record* records, std::size_t n, const EventBatch& batch)
+    {
+        const std::vector<Event>& payloads = std::get<Model::template EventIndex<Event>()>(batch.mPayloads);
+        for (std::size_t i = 0; i < n; ++i)
+            Model::Dispatch(states[records[i].handle], payloads[records[i].slot]);
+    }
+
+    template <class Model>
+    template <class StateId, class... Events>
+    constexpr typename EventBatch<Model>::template BucketDispatchers<StateId, Packer<Events...>>::BucketFn
+        EventBatch<Model>::BucketDispatchers<StateId, Packer<Events...>>::dispatchers[];
+}
+
+#endif // ! _EVENT_BATCH_HPP_
@@ -0,0 +1,310 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#ifndef _EXECUTOR_HPP_
+#define _EXECUTOR_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <Gearless/Mailbox.hpp>
+
+namespace Gearless
+{
+    ///==============================================================
+    ///= Executor
+    ///==============================================================
+    // Pool of worker threads running tasks from per-worker deques. A worker
+    // takes the task most recently scheduled by itself from its own deque for
+    // cache locality and, once that runs dry, steals the oldest task of
+    // another worker. Tasks scheduled from outside the pool and tasks
+    // rescheduled after a run queue up behind the others instead, so a busy
+    // task cannot starve its neighbours. Each deque has its own lock, taken
+    // for a push or pop only, so contention is limited to the rare steals.
+    // Idle workers sleep until new tasks are scheduled
+    class Executor
+    {
+        public:
+            ///==========================================================
+            ///= Task
+            ///==========================================================
+            class Task
+            {
+                public:
+                    virtual ~Task() {}
+
+                    /// Called on a worker thread each time the task is picked up
+                    virtual void Run() = 0;
+            };
+
+            /// Starts the given number of worker threads
+            explicit Executor(unsigned threadCount = std::thread::hardware_concurrency());
+
+            /// Stops and joins the workers, tasks that did not start yet are dropped
+            ~Executor();
+
+            Executor(const Executor&) = delete;
+            Executor& operator=(const Executor&) = delete;
+
+            /// Queues the task for execution, may be called from any thread.
+            /// Tasks scheduled from a worker go to that worker's own deque
+            /// and run next
+            void Schedule(Task* task);
+
+            /// Queues a task that wants to run again behind the tasks already
+            /// waiting, which is how long running tasks yield their worker
+            void Reschedule(Task* task);
+
+            /// Retrieves the number of worker threads
+            std::size_t ThreadCount() const noexcept { return mWorkers.size(); }
+
+        private:
+            struct Worker
+            {
+                std::mutex lock;
+                std::deque<Task*> tasks;
+                std::thread thread;
+            };
+
+            void WorkerLoop(std::size_t self);
+            Task* PopLocal(std::size_t self);
+            Task* Steal(std::size_t self);
+            void Push(Task* task, bool next);
+
+            /// The worker the calling thread belongs to, if any
+            static std::pair<Executor*, std::size_t>& CurrentWorker()
+            {
+                static thread_local std::pair<Executor*, std::size_t> current(nullptr, 0);
+                return current;
+            }
+
+            std::vector<std::unique_ptr<Worker>> mWorkers;
+
+            /// Number of tasks sitting in the deques
+            std::atomic<std::size_t> mQueued;
+
+            /// Round robin target for tasks scheduled from outside the pool
+            std::atomic<std::size_t> mNextWorker;
+
+            /// Parking of idle workers
+            std::mutex mSleepLock;
+            std::condition_variable mWakeUp;
+            std::atomic<std::size_t> mSleepers;
+            std::atomic<bool> mStop;
+    };
+
+    inline Executor::Executor(unsigned threadCount)
+        : mQueued(0), mNextWorker(0), mSleepers(0), mStop(false)
+    {
+        if (threadCount == 0)
+            threadCount = 1;
+        for (unsigned i = 0; i < threadCount; ++i)
+            mWorkers.emplace_back(new Worker);
+        for (std::size_t i = 0; i < mWorkers.size(); ++i)
+            mWorkers[i]->thread = std::thread(&Executor::WorkerLoop, this, i);
+    }
+
+    inline Executor::~Executor()
+    {
+        {
+            std::lock_guard<std::mutex> guard(mSleepLock);
+            mStop.store(true);
+        }
+        mWakeUp.notify_all();
+        for (std::unique_ptr<Worker>& w : mWorkers)
+            w->thread.join();
+    }
+
+    inline void Executor::Schedule(Task* task)
+    {
+        Push(task, CurrentWorker().first == this);
+    }
+
+    inline void Executor::Reschedule(Task* task)
+    {
+        Push(task, false);
+    }
+
+    inline void Executor::Push(Task* task, bool next)
+    {
+        // The owner pops from the back, so the front is the end of the line
+        const std::pair<Executor*, std::size_t>& current = CurrentWorker();
+        const std::size_t target = current.first == this
+            ? current.second
+            : mNextWorker.fetch_add(1, std::memory_order_relaxed) % mWorkers.size();
+        {
+            std::lock_guard<std::mutex> guard(mWorkers[target]->lock);
+            if (next)
+                mWorkers[target]->tasks.push_back(task);
+            else
+                mWorkers[target]->tasks.push_front(task);
+        }
+        mQueued.fetch_add(1);
+
+        // Pairs with the sleeper registration in WorkerLoop: either the sleeper
+        // sees the queued task or we see the sleeper and wake it up
+        if (mSleepers.load() != 0)
+        {
+            std::lock_guard<std::mutex> guard(mSleepLock);
+            mWakeUp.notify_one();
+        }
+    }
+
+    inline Executor::Task* Executor::PopLocal(std::size_t self)
+    {
+        Worker& w = *mWorkers[self];
+        std::lock_guard<std::mutex> guard(w.lock);
+        if (w.tasks.empty())
+            return nullptr;
+        Task* task = w.tasks.back();
+        w.tasks.pop_back();
+        return task;
+    }
+
+    inline Executor::Task* Executor::Steal(std::size_t self)
+    {
+        for (std::size_t i = 1; i < mWorkers.size(); ++i)
+        {
+            Worker& victim = *mWorkers[(self + i) % mWorkers.size()];
+            std::lock_guard<std::mutex> guard(victim.lock);
+            if (!victim.tasks.empty())
+            {
+                Task* task = victim.tasks.front();
+                victim.tasks.pop_front();
+                return task;
+            }
+        }
+        return nullptr;
+    }
+
+    inline void Executor::WorkerLoop(std::size_t self)
+    {
+        CurrentWorker() = std::make_pair(this, self);
+        while (!mStop.load(std::memory_order_relaxed))
+        {
+            Task* task = PopLocal(self);
+            if (!task)
+                task = Steal(self);
+            if (task)
+            {
+                mQueued.fetch_sub(1);
+                task->Run();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> guard(mSleepLock);
+            mSleepers.fetch_add(1);
+            mWakeUp.wait(guard, [this]() { return mQueued.load() != 0 || mStop.load(); });
+            mSleepers.fetch_sub(1);
+        }
+    }
+
+    ///==============================================================
+    ///= Actor
+    ///==============================================================
+    // A machine with its own mailbox, run by an Executor. The actor is
+    // scheduled when its count of pending events goes from zero to one and
+    // keeps rescheduling itself behind the other queued tasks while events
+    // remain, at most RunBudget events at a time, so exactly one worker
+    // owns it at any time and its machine is never run on two threads at
+    // once. Destroying an actor waits for its posted events to be processed,
+    // so actors have to go before their executor
+    template <class Machine, std::size_t Capacity = 1024, std::size_t InlineSize = 64>
+    class Actor : public Executor::Task
+    {
+        public:
+            /// Maximum number of events handled per run before yielding the worker
+            static constexpr std::size_t RunBudget = 64;
+
+            explicit Actor(Executor& executor) : mExecutor(executor), mPending(0) {}
+
+            /// Waits for the worker owning the actor, if any, to let it go
+            ~Actor();
+
+            /// Posts an event from any thread, scheduling the actor if it was idle.
+            /// Returns false if the mailbox is full
+            template <class Event>
+            bool PostEvent(Event&& ev);
+
+            /// Direct access to the machine, only safe while no events are pending
+            Machine& GetMachine() noexcept { return mMachine; }
+            const Machine& GetMachine() const noexcept { return mMachine; }
+
+        private:
+            void Run() override;
+
+            Executor& mExecutor;
+            Machine mMachine;
+            Mailbox<Machine, Capacity, InlineSize> mMailbox;
+
+            /// Events posted and not processed yet, counted after they are enqueued
+            std::atomic<std::size_t> mPending;
+    };
+
+    template <class Machine, std::size_t Capacity, std::size_t InlineSize>
+    constexpr std::size_t Actor<Machine, Capacity, InlineSize>::RunBudget;
+
+    template <class Machine, std::size_t Capacity, std::size_t InlineSize>
+    inline Actor<Machine, Capacity, InlineSize>::~Actor()
+    {
+        // Run does not touch the actor anymore once the count drops to zero
+        while (mPending.load(std::memory_order_acquire) != 0)
+            std::this_thread::yield();
+    }
+
+    template <class Machine, std::size_t Capacity, std::size_t InlineSize>
+    template <class Event>
+    inline bool Actor<Machine, Capacity, InlineSize>::PostEvent(Event&& ev)
+    {
+        if (!mMailbox.PostEvent(std::forward<Event>(ev)))
+            return false;
+        if (mPending.fetch_add(1, std::memory_order_acq_rel) == 0)
+            mExecutor.Schedule(this);
+        return true;
+    }
+
+    template <class Machine, std::size_t Capacity, std::size_t InlineSize>
+    inline void Actor<Machine, Capacity, InlineSize>::Run()
+    {
+        // Only drain counted events, which are known to be in the mailbox already
+        const std::size_t pending = mPending.load(std::memory_order_acquire);
+        const std::size_t n = mMailbox.Drain(mMachine, pending < RunBudget ? pending : RunBudget);
+        if (mPending.fetch_sub(n, std::memory_order_acq_rel) != n)
+            mExecutor.Reschedule(this);
+    }
+}
+
+#endif // ! _EXECUTOR_HPP_
@@ -0,0 +1,571 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#ifndef _HIERARCHY_HPP_
+#define _HIERARCHY_HPP_
+
+#include <cstddef>
+#include <type_traits>
+#include <Gearless/TypeId.hpp>
+#include <Gearless/TypeList.hpp>
+
+namespace Gearless
+{
+    template <class T>
+    struct VoidType
+    {
+        using type = void;
+    };
+
+    ///==============================================================
+    ///= ParentOf
+    ///==============================================================
+    // A state joins a composite state by declaring it as its nested Parent type
+    template <class State, class = void>
+    struct ParentOf
+    {
+        using type = void;
+    };
+
+    template <class State>
+    struct ParentOf<State, typename VoidType<typename State::Parent>::type>
+    {
+        using type = typename State::Parent;
+    };
+
+    ///==============================================================
+    ///= StateDepth
+    ///==============================================================
+    // Number of ancestors of the given state, 0 for top level states
+    template <class State, class Parent = typename ParentOf<State>::type>
+    struct StateDepth : std::integral_constant<std::size_t, 1 + StateDepth<Parent>::value> {};
+
+    template <class State>
+    struct StateDepth<State, void> : std::integral_constant<std::size_t, 0> {};
+
+    ///==============================================================
+    ///= AncestorsOf
+    ///==============================================================
+    // The enclosing states of the given state, innermost first
+    template <class State, class Parent = typename ParentOf<State>::type>
+    struct AncestorsOf
+    {
+        using type = typename PackConcat<Packer<Parent>, typename AncestorsOf<Parent>::type>::type;
+    };
+
+    template <class State>
+    struct AncestorsOf<State, void>
+    {
+        using type = Packer<>;
+    };
+
+    ///==============================================================
+    ///= IsDescendant
+    ///==============================================================
+    // Whether State is Ancestor itself or is nested somewhere inside it
+    template <class State, class Ancestor>
+    struct IsDescendant
+        : std::integral_constant<bool,
+            std::is_same<State, Ancestor>::value ||
+            PackContains<Ancestor, typename AncestorsOf<State>::type>::value> {};
+
+    ///==============================================================
+    ///= InitialLeaf
+    ///==============================================================
+    // A composite state names the child it enters by default as its nested
+    // Initial type. Entering a state ends up in the leaf found by following
+    // Initial children down from it
+    template <class State, class = void>
+    struct InitialLeaf
+    {
+        using type = State;
+    };
+
+    template <class State>
+    struct InitialLeaf<State, typename VoidType<typename State::Initial>::type>
+    {
+        static_assert(std::is_same<typename ParentOf<typename State::Initial>::type, State>::value,
+                      "The Initial child of a composite state must declare it as its Parent");
+        using type = typename InitialLeaf<typename State::Initial>::type;
+    };
+
+    ///==============================================================
+    ///= History
+    ///==============================================================
+    // Transition targets re-entering a composite state where it was last
+    // left. ShallowHistory restores the direct child that was active and
+    // enters it by default, DeepHistory restores the leaf that was active.
+    // Until the composite is first left both behave like the composite
+    template <class Composite>
+    struct ShallowHistory {};
+
+    template <class Composite>
+    struct DeepHistory {};
+
+    template <class Target>
+    struct IsHistory : std::false_type {};
+
+    template <class Composite>
+    struct IsHistory<ShallowHistory<Composite>> : std::true_type {};
+
+    template <class Composite>
+    struct IsHistory<DeepHistory<Composite>> : std::true_type {};
+
+    // The state actually entered by a transition target, the composite for history targets
+    template <class Target>
+    struct EnteredState
+    {
+        using type = Target;
+    };
+
+    template <class Composite>
+    struct EnteredState<ShallowHistory<Composite>>
+    {
+        using type = Composite;
+    };
+
+    template <class Composite>
+    struct EnteredState<DeepHistory<Composite>>
+    {
+        using type = Composite;
+    };
+
+    ///==============================================================
+    ///= Defer
+    ///==============================================================
+    // Declared in the transition table next to the transitions, a deferral
+    // postpones the event while the machine is in the given state, or in a
+    // state nested inside it that has no transition of its own for it. The
+    // event is queued and dispatched again once the machine changes state
+    template <class State, class Ev>
+    struct Defer
+    {
+        using PrevState = State;
+        using Event = Ev;
+    };
+
+    template <class Entry>
+    struct IsDeferral : std::false_type {};
+
+    template <class State, class Ev>
+    struct IsDeferral<Defer<State, Ev>> : std::true_type {};
+
+    template <class Entry>
+    struct IsTransition : std::integral_constant<bool, !IsDeferral<Entry>::value> {};
+
+    // The deduplicated event types of the given deferrals
+    template <class Deferrals>
+    struct DeferredEventsOf;
+
+    template <class... Deferrals>
+    struct DeferredEventsOf<Packer<Deferrals...>>
+    {
+        using type = typename TypeSet<typename Deferrals::Event...>::type;
+    };
+
+    ///==============================================================
+    ///= StateChain
+    ///==============================================================
+    // The given state followed by its enclosing states, innermost first
+    template <class State>
+    struct StateChain
+    {
+        using type = typename PackConcat<Packer<State>, typename AncestorsOf<State>::type>::type;
+    };
+
+    // The enclosing states of the given state followed by itself, outermost first
+    template <class State, class Parent = typename ParentOf<State>::type>
+    struct StateChainFromTop
+    {
+        using type = typename PackConcat<typename StateChainFromTop<Parent>::type, Packer<State>>::type;
+    };
+
+    template <class State>
+    struct StateChainFromTop<State, void>
+    {
+        using type = Packer<State>;
+    };
+
+    ///==============================================================
+    ///= TransitionDomain
+    ///==============================================================
+    // The innermost state that strictly encloses both ends of a transition,
+    // or void if only the top level does. Everything inside it along the
+    // way is left and entered again, as for UML external transitions
+    template <class Source, class Target>
+    struct TransitionDomain
+    {
+        template <class State>
+        struct EnclosesTarget : PackContains<State, typename AncestorsOf<Target>::type> {};
+
+        using type = typename PackFront<
+            typename PackFilter<EnclosesTarget, typename AncestorsOf<Source>::type>::type
+        >::type;
+    };
+
+    template <class State>
+    struct InsideOf
+    {
+        template <class Other>
+        struct Pred : IsDescendant<Other, State> {};
+    };
+
+    template <class Domain>
+    struct StrictlyInside
+    {
+        template <class State>
+        struct Pred : std::integral_constant<bool,
+            std::is_void<Domain>::value ||
+            (!std::is_same<State, Domain>::value && IsDescendant<State, Domain>::value)> {};
+    };
+
+    // Whether a state is none of the given states, with one base class search
+    template <class Pack>
+    struct NotIn
+    {
+        template <class State>
+        struct Pred : std::integral_constant<bool, !PackContains<State, Pack>::value> {};
+    };
+
+    ///==============================================================
+    ///= StateHooks
+    ///==============================================================
+    // States may declare static OnEntry() and OnExit() members, which are
+    // called when a transition enters or leaves them
+    template <class State, class = void>
+    struct HasOnEntryImpl : std::false_type {};
+
+    template <class State>
+    struct HasOnEntryImpl<State, typename VoidType<decltype(State::OnEntry())>::type> : std::true_type {};
+
+    template <class State>
+    struct HasOnEntry : HasOnEntryImpl<State> {};
+
+    template <class State, class = void>
+    struct HasOnExitImpl : std::false_type {};
+
+    template <class State>
+    struct HasOnExitImpl<State, typename VoidType<decltype(State::OnExit())>::type> : std::true_type {};
+
+    template <class State>
+    struct HasOnExit : HasOnExitImpl<State> {};
+
+    // Straight line sequence of hook calls over the given states, in order
+    template <class States>
+    struct HookCalls;
+
+    template <class... States>
+    struct HookCalls<Packer<States...>>
+    {
+        static void Exit()
+        {
+            using Sequence = int[];
+            (void)Sequence{ 0, (States::OnExit(), 0)... };
+        }
+
+        static void Enter()
+        {
+            using Sequence = int[];
+            (void)Sequence{ 0, (States::OnEntry(), 0)... };
+        }
+    };
+
+    /// The hooks run when entering the given leaf from the top level, outermost first
+    template <class Leaf>
+    using StartEntries = typename PackFilter<HasOnEntry, typename StateChainFromTop<Leaf>::type>::type;
+
+    /// The hooks run when leaving the given leaf to the top level, innermost first
+    template <class Leaf>
+    using StopExits = typename PackFilter<HasOnExit, typename StateChain<Leaf>::type>::type;
+
+    template <class Leaf>
+    struct HasStopExits : std::integral_constant<bool, PackSize<StopExits<Leaf>>::value != 0> {};
+
+    // Compare and branch cascade running the exit hooks of the current leaf,
+    // over the leaves that have any of them
+    template <class States, class Hooked = typename PackFilter<HasStopExits, States>::type>
+    struct StopCascade
+    {
+        static void Exit(std::size_t) {}
+    };
+
+    template <class States, class Leaf, class... Rest>
+    struct StopCascade<States, Packer<Leaf, Rest...>>
+    {
+        static void Exit(std::size_t state)
+        {
+            if (state == TypeIndex<Leaf, States>::value)
+                HookCalls<StopExits<Leaf>>::Exit();
+            else
+                StopCascade<States, Packer<Rest...>>::Exit(state);
+        }
+    };
+
+    ///==============================================================
+    // A transition declared on a state, replicated onto one of the leaves
+    // nested inside it and retargeted to the leaf its next state enters.
+    // The hooks it runs on the way are resolved here once and for all
+    template <class Leaf, class Transit>
+    struct FlatTransition
+    {
+        using PrevState = Leaf;
+        using Event = typename Transit::Event;
+        using Entered = typename EnteredState<typename Transit::NextState>::type;
+        using TransFn = typename Transit::TransFn;
+        using TransGuard = typename Transit::TransGuard;
+
+        /// The leaf entered by default, for history targets when there is no history yet
+        using NextState = typename InitialLeaf<Entered>::type;
+
+        /// The history pseudo-state picking the leaf entered at runtime, or void
+        using Restores = typename std::conditional<IsHistory<typename Transit::NextState>::value,
+            typename Transit::NextState, void>::type;
+
+        /// The transition as written in the table
+        using Declared = Transit;
+
+        /// The innermost state the transition stays within
+        using Domain = typename TransitionDomain<typename Transit::PrevState, Entered>::type;
+
+        /// The states left, innermost first
+        using Left = typename PackFilter<StrictlyInside<Domain>::template Pred, typename StateChain<Leaf>::type>::type;
+
+        /// The states left with an OnExit hook, innermost first
+        using Exits = typename PackFilter<HasOnExit, Left>::type;
+
+        /// The states entered with an OnEntry hook, outermost first. History
+        /// targets stop at their composite, the rest is only known at runtime
+        using Entries = typename PackFilter<HasOnEntry, typename PackFilter<
+            StrictlyInside<Domain>::template Pred,
+            typename StateChainFromTop<typename std::conditional<std::is_void<Restores>::value, NextState, Entered>::type>::type
+        >::type>::type;
+    };
+
+    ///==============================================================
+    // A deferral declared on a state, replicated onto one of the leaves
+    // nested inside it. It is found like a transition, but stays in the
+    // leaf without running anything and leaves the event to be queued
+    struct NoAction;
+    struct NoGuard;
+
+    template <class Leaf, class Deferral>
+    struct FlatDeferral
+    {
+        using PrevState = Leaf;
+        using Event = typename Deferral::Event;
+        using NextState = Leaf;
+        using TransFn = NoAction;
+        using TransGuard = NoGuard;
+        using Restores = void;
+        using Declared = Deferral;
+        using Exits = Packer<>;
+        using Entries = Packer<>;
+    };
+
+    template <class Leaf, class Entry>
+    using FlatRow = typename std::conditional<IsDeferral<Entry>::value,
+        FlatDeferral<Leaf, Entry>, FlatTransition<Leaf, Entry>>::type;
+
+    ///==============================================================
+    ///= DeclaredDepths
+    ///==============================================================
+    template <class... Transitions>
+    struct DeclaredDepths
+    {
+        static constexpr std::size_t RowCount = sizeof...(Transitions);
+
+        /// Depth of the state declaring every transition, after a leading 0
+        static constexpr ConstArray<std::size_t, 1 + sizeof...(Transitions)> Make()
+        {
+            return {{ 0, StateDepth<typename Transitions::PrevState>::value... }};
+        }
+
+        /// Depth of the state declaring the given row
+        static constexpr std::size_t DepthOf(std::size_t row) { return ConstTable<DeclaredDepths>::table.values[row + 1]; }
+
+        /// Returns the greatest depth in [lo, hi)
+        static constexpr std::size_t Max(std::size_t lo, std::size_t hi)
+        {
+            // Split the range in halves to keep the constexpr recursion depth logarithmic
+            return hi - lo == 1
+                ? ConstTable<DeclaredDepths>::table.values[lo]
+                : Greater(Max(lo, lo + (hi - lo) / 2), Max(lo + (hi - lo) / 2, hi));
+        }
+
+        private:
+            static constexpr std::size_t Greater(std::size_t a, std::size_t b) { return a < b ? b : a; }
+    };
+
+    template <class... Transitions>
+    constexpr std::size_t DeclaredDepths<Transitions...>::RowCount;
+
+    // Sort keys putting the rows of deeper declaring states first
+    template <class Depths, std::size_t MaxDepth>
+    struct DepthKeys
+    {
+        static constexpr std::size_t RowCount = Depths::RowCount;
+        static constexpr std::size_t KeyOf(std::size_t row) { return MaxDepth - Depths::DepthOf(row); }
+    };
+
+    template <class Depths, std::size_t MaxDepth>
+    constexpr std::size_t DepthKeys<Depths, MaxDepth>::RowCount;
+
+    ///==============================================================
+    ///= DeepestFirst
+    ///==============================================================
+    // The entries of a table ordered from the deepest declaring state to the
+    // outermost one, in declaration order among entries of the same depth.
+    // It takes one sort of the rows by depth, and nothing at all for flat
+    // machines whose states all lie at depth 0
+    template <class Entries, class Depths,
+              std::size_t MaxDepth = Depths::Max(0, 1 + Depths::RowCount)>
+    struct DeepestFirst
+    {
+        using type = typename PackSelect<Entries, typename SortedRowRange<
+            SortedRows<DepthKeys<Depths, MaxDepth>>, 0,
+            typename MakeIndexSeq<Depths::RowCount>::type
+        >::type>::type;
+    };
+
+    template <class Entries, class Depths>
+    struct DeepestFirst<Entries, Depths, 0>
+    {
+        using type = Entries;
+    };
+
+    ///==============================================================
+    ///= FlattenEntries
+    ///==============================================================
+    template <class Entry, class Leaves>
+    struct CopyOnto;
+
+    template <class Entry, class... Leaves>
+    struct CopyOnto<Entry, Packer<Leaves...>>
+    {
+        using type = Packer<FlatRow<Leaves, Entry>...>;
+    };
+
+    // The rows of one table entry. Entries of leaf states, the only ones of
+    // flat machines, are kept as they are, those of composite states are
+    // copied onto every leaf inside them
+    template <class Entry, class Composites, class States,
+              bool Composite = PackContains<typename Entry::PrevState, Composites>::value>
+    struct FlattenEntry
+    {
+        using type = Packer<FlatRow<typename Entry::PrevState, Entry>>;
+    };
+
+    template <class Entry, class Composites, class States>
+    struct FlattenEntry<Entry, Composites, States, true>
+    {
+        using type = typename CopyOnto<Entry,
+            typename PackFilter<InsideOf<typename Entry::PrevState>::template Pred, States>::type>::type;
+    };
+
+    template <class Entries, class Composites, class States>
+    struct FlattenEntries;
+
+    template <class... Entries, class Composites, class States>
+    struct FlattenEntries<Packer<Entries...>, Composites, States>
+    {
+        using type = typename PackConcat<typename FlattenEntry<Entries, Composites, States>::type...>::type;
+    };
+
+    ///==============================================================
+    ///= Hierarchy
+    ///==============================================================
+    // Flattens a transition table over composite states into a table over
+    // leaf states only. Each transition declared on a composite state is
+    // copied onto every leaf inside it, and the copies are ordered from the
+    // deepest declaring state to the outermost one, so that the first row
+    // matching a (leaf, event) pair is the one of the innermost state that
+    // handles the event. Dispatch then costs the same as in a flat machine.
+    // Deferrals are flattened alongside, so that the innermost state decides
+    // between handling an event and deferring it. The work is done by
+    // templates outside of this one, whose instantiations would otherwise
+    // carry the whole table in their arguments
+    template <class InitState, class TransitionsPack,
+              class Transitions = typename PackFilter<IsTransition, TransitionsPack>::type>
+    struct Hierarchy;
+
+    template <class InitState, class... Entries, class... Transitions>
+    struct Hierarchy<InitState, Packer<Entries...>, Packer<Transitions...>>
+    {
+        /// The states enclosing some other state of the machine
+        using Composites = typename PackUnique<typename PackConcat<
+            typename AncestorsOf<typename InitialLeaf<InitState>::type>::type,
+            typename AncestorsOf<typename InitialLeaf<typename Entries::PrevState>::type>::type...,
+            typename AncestorsOf<typename InitialLeaf<typename EnteredState<typename Transitions::NextState>::type>::type>::type...
+        >::type>::type;
+
+        /// The leaf states of the machine with the one entered at start at index 0
+        using States = typename PackFilter<NotIn<Composites>::template Pred, typename TypeSet<
+            typename InitialLeaf<InitState>::type,
+            typename InitialLeaf<typename Entries::PrevState>::type...,
+            typename InitialLeaf<typename EnteredState<typename Transitions::NextState>::type>::type...
+        >::type>::type;
+
+        static_assert(PackSize<typename PackFilter<NotIn<Composites>::template Pred, Packer<
+                          typename InitialLeaf<InitState>::type,
+                          typename InitialLeaf<typename EnteredState<typename Transitions::NextState>::type>::type...
+                      >>::type>::value == 1 + sizeof...(Transitions),
+                      "A composite state that is entered must declare its Initial child");
+
+        /// The events some state defers
+        using DeferredEvents = typename DeferredEventsOf<typename PackFilter<IsDeferral, Packer<Entries...>>::type>::type;
+
+        /// The history pseudo-states targeted by some transition
+        using HistoryKeys = typename PackUnique<typename PackFilter<IsHistory, Packer<typename Transitions::NextState...>>::type>::type;
+
+        /// The (leaf, event) transitions and deferrals, innermost declaring state first
+        using FlatTransitions = typename FlattenEntries<
+            typename DeepestFirst<Packer<Entries...>, DeclaredDepths<Entries...>>::type,
+            Composites, States
+        >::type;
+    };
+
+    ///==============================================================
+    ///= InStateFlags
+    ///==============================================================
+    // For every leaf state, whether it lies inside the given state
+    template <class State, class Leaves>
+    struct InStateFlags;
+
+    template <class State, class... Leaves>
+    struct InStateFlags<State, Packer<Leaves...>>
+    {
+        static constexpr bool values[sizeof...(Leaves)] = { IsDescendant<Leaves, State>::value... };
+    };
+
+    template <class State, class... Leaves>
+    constexpr bool InStateFlags<State, Packer<Leaves...>>::values[];
+}
+
+#endif // ! _HIERARCHY_HPP_
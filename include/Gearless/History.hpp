@@ -0,0 +1,215 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#ifndef _HISTORY_HPP_
+#define _HISTORY_HPP_
+
+#include <cstddef>
+#include <type_traits>
+#include <Gearless/Dispatch.hpp>
+#include <Gearless/Hierarchy.hpp>
+
+namespace Gearless
+{
+    ///==============================================================
+    ///= HistoryMembers
+    ///==============================================================
+    // The direct child of Composite that holds the given leaf
+    template <class Composite, class Leaf>
+    struct ChildOf
+    {
+        template <class State>
+        struct HasParent : std::is_same<typename ParentOf<State>::type, Composite> {};
+
+        using type = typename PackFront<typename PackFilter<HasParent, typename StateChain<Leaf>::type>::type>::type;
+    };
+
+    // What a history pseudo-state remembers about its composite: Member<Leaf>
+    // is the member recorded when leaving from the given leaf, and
+    // RestoredLeaf<Member> the leaf entered again when restoring it
+    template <class Key, class States>
+    struct HistoryMembers;
+
+    template <class Composite, class States>
+    struct HistoryMembers<DeepHistory<Composite>, States>
+    {
+        using type = typename PackFilter<InsideOf<Composite>::template Pred, States>::type;
+
+        template <class Leaf>
+        using Member = Leaf;
+
+        template <class Member>
+        using RestoredLeaf = Member;
+    };
+
+    template <class Composite, class States>
+    struct HistoryMembers<ShallowHistory<Composite>, States>
+    {
+        template <class Leaves>
+        struct Children;
+
+        template <class... Leaves>
+        struct Children<Packer<Leaves...>>
+        {
+            using type = typename PackUnique<Packer<typename ChildOf<Composite, Leaves>::type...>>::type;
+        };
+
+        using type = typename Children<typename PackFilter<InsideOf<Composite>::template Pred, States>::type>::type;
+
+        template <class Leaf>
+        using Member = typename ChildOf<Composite, Leaf>::type;
+
+        template <class Member>
+        using RestoredLeaf = typename InitialLeaf<Member>::type;
+    };
+
+    ///==============================================================
+    ///= HistorySlot
+    ///==============================================================
+    // The last active member of one composite, as an index sized to the
+    // member count. Restoring it is a single load from the leaves table
+    template <class Key, class States, class Members = typename HistoryMembers<Key, States>::type>
+    struct HistorySlot;
+
+    template <class Key, class States, class... Members>
+    struct HistorySlot<Key, States, Packer<Members...>>
+    {
+        using Traits = HistoryMembers<Key, States>;
+        using Value = typename SmallestUInt<sizeof...(Members) - 1>::type;
+        using StateId = typename SmallestUInt<PackSize<States>::value - 1>::type;
+
+        /// The leaf restored for every recorded member
+        static constexpr StateId leaves[sizeof...(Members)] = {
+            static_cast<StateId>(TypeIndex<typename Traits::template RestoredLeaf<Members>, States>::value)...
+        };
+
+        /// The value recorded when leaving the composite from the given leaf
+        template <class Leaf>
+        static constexpr Value RecordOf()
+        {
+            return static_cast<Value>(PackIndexOf<typename Traits::template Member<Leaf>, Packer<Members...>>::value);
+        }
+
+        /// Starts out as if the composite had been left from its initial leaf
+        Value value = static_cast<Value>(PackIndexOf<
+            typename Traits::template Member<typename InitialLeaf<typename EnteredState<Key>::type>::type>,
+            Packer<Members...>>::value);
+    };
+
+    template <class Key, class States, class... Members>
+    constexpr typename HistorySlot<Key, States, Packer<Members...>>::StateId
+        HistorySlot<Key, States, Packer<Members...>>::leaves[];
+
+    ///==============================================================
+    ///= HistoryStorage
+    ///==============================================================
+    // The history slots of every history pseudo-state of a machine, empty
+    // for machines without any so that it costs nothing as a base class
+    template <class States, class Keys>
+    struct HistoryStorage;
+
+    template <class States, class... Keys>
+    struct HistoryStorage<States, Packer<Keys...>> : HistorySlot<Keys, States>...
+    {
+        template <class Key>
+        HistorySlot<Key, States>& Slot() noexcept { return *this; }
+    };
+
+    // The composites with history that a flattened transition leaves
+    template <class Transit>
+    struct LeftBy
+    {
+        template <class Key>
+        struct Pred : PackContains<typename EnteredState<Key>::type, typename Transit::Left> {};
+    };
+
+    template <class Transit, class States, class... Keys>
+    inline void RecordHistory(HistoryStorage<States, Packer<Keys...>>&, Packer<>) {}
+
+    template <class Transit, class States, class... Keys, class... Recorded>
+    inline void RecordHistory(HistoryStorage<States, Packer<Keys...>>& history, Packer<Recorded...>)
+    {
+        using Sequence = int[];
+        (void)Sequence{ 0, (history.template Slot<Recorded>().value =
+            HistorySlot<Recorded, States>::template RecordOf<typename Transit::PrevState>(), 0)... };
+    }
+
+    /// Records the last active member of every composite with history left by the transition
+    template <class Transit, class States, class... Keys>
+    inline void RecordHistory(HistoryStorage<States, Packer<Keys...>>& history)
+    {
+        RecordHistory<Transit>(history, typename PackFilter<LeftBy<Transit>::template Pred, Packer<Keys...>>::type());
+    }
+
+    /// Retrieves the leaf entered through the given history pseudo-state
+    template <class Key, class States, class Keys>
+    inline std::size_t RestoreHistory(HistoryStorage<States, Keys>& history)
+    {
+        return HistorySlot<Key, States>::leaves[history.template Slot<Key>().value];
+    }
+
+    ///==============================================================
+    ///= RestoredEntries
+    ///==============================================================
+    /// The hooks run below the given composite when entering the given leaf, outermost first
+    template <class Composite, class Leaf>
+    using EntriesBelow = typename PackFilter<HasOnEntry, typename PackFilter<
+        StrictlyInside<Composite>::template Pred, typename StateChainFromTop<Leaf>::type>::type>::type;
+
+    template <class Composite>
+    struct HasEntriesBelow
+    {
+        template <class Leaf>
+        struct Pred : std::integral_constant<bool, PackSize<EntriesBelow<Composite, Leaf>>::value != 0> {};
+    };
+
+    // Compare and branch cascade running the entry hooks below a composite
+    // re-entered through history, over the leaves that have any of them
+    template <class Composite, class States,
+              class Hooked = typename PackFilter<HasEntriesBelow<Composite>::template Pred, States>::type>
+    struct RestoredEntries
+    {
+        static void Enter(std::size_t) {}
+    };
+
+    template <class Composite, class States, class Leaf, class... Rest>
+    struct RestoredEntries<Composite, States, Packer<Leaf, Rest...>>
+    {
+        static void Enter(std::size_t state)
+        {
+            if (state == TypeIndex<Leaf, States>::value)
+                HookCalls<EntriesBelow<Composite, Leaf>>::Enter();
+            else
+                RestoredEntries<Composite, States, Packer<Rest...>>::Enter(state);
+        }
+    };
+}
+
+#endif // ! _HISTORY_HPP_
@@ -0,0 +1,372 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#ifndef _LATENCY_OBSERVER_HPP_
+#define _LATENCY_OBSERVER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <Gearless/Clock.hpp>
+
+namespace Gearless
+{
+    ///==============================================================
+    ///= LatencyHistogram
+    ///==============================================================
+    // Fixed size log-linear histogram in the manner of HdrHistogram. Values
+    // below 2^SubBucketBits get a bucket each, and every power of two above
+    // is split into 2^SubBucketBits buckets, which bounds the relative error
+    // of every recorded value by 2^-SubBucketBits. Values from 2^MaxBits on
+    // are recorded into the last bucket
+    template <unsigned SubBucketBits = 3, unsigned MaxBits = 40>
+    class LatencyHistogram
+    {
+        static_assert(SubBucketBits >= 1 && SubBucketBits < MaxBits && MaxBits < 64, "Invalid histogram bucket layout");
+
+        public:
+            static constexpr std::size_t SubBucketCount = std::size_t(1) << SubBucketBits;
+            static constexpr std::size_t BucketCount = (MaxBits - SubBucketBits + 1) * SubBucketCount;
+
+            LatencyHistogram() noexcept { Reset(); }
+
+            /// Records one sample
+            void Record(std::uint64_t value) noexcept;
+
+            /// Number of samples recorded
+            std::uint64_t Count() const noexcept { return mCount; }
+
+            /// Greatest sample recorded, exactly
+            std::uint64_t Max() const noexcept { return mMax; }
+
+            /// The value at or below which the given fraction in [0, 1] of the
+            /// samples lie, rounded up to the upper bound of its bucket
+            std::uint64_t Percentile(double fraction) const noexcept;
+
+            /// Index of the bucket a value is recorded into
+            static std::size_t BucketOf(std::uint64_t value) noexcept;
+
+            /// Greatest value recorded into the given bucket
+            static std::uint64_t UpperBound(std::size_t bucket) noexcept;
+
+            /// Forgets every sample
+            void Reset() noexcept;
+
+        private:
+            static unsigned HighestBit(std::uint64_t value) noexcept;
+
+            std::uint64_t mCounts[BucketCount];
+            std::uint64_t mCount;
+            std::uint64_t mMax;
+    };
+
+    template <unsigned SubBucketBits, unsigned MaxBits>
+    constexpr std::size_t LatencyHistogram<SubBucketBits, MaxBits>::SubBucketCount;
+
+    template <unsigned SubBucketBits, unsigned MaxBits>
+    constexpr std::size_t LatencyHistogram<SubBucketBits, MaxBits>::BucketCount;
+
+    template <unsigned SubBucketBits, unsigned MaxBits>
+    inline unsigned LatencyHistogram<SubBucketBits, MaxBits>::HighestBit(std::uint64_t value) noexcept
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return 63u - static_cast<unsigned>(__builtin_clzll(value));
+#else
+        unsigned n = 0;
+        while (value >>= 1) ++n;
+        return n;
+#endif
+    }
+
+    template <unsigned SubBucketBits, unsigned MaxBits>
+    inline std::size_t LatencyHistogram<SubBucketBits, MaxBits>::BucketOf(std::uint64_t value) noexcept
+    {
+        if (value < SubBucketCount)
+            return static_cast<std::size_t>(value);
+        if (value >> MaxBits)
+            return BucketCount - 1;
+        // The highest bit picks the power of two, the next SubBucketBits the bucket within it
+        const unsigned shift = HighestBit(value) - SubBucketBits;
+        return (shift + 1) * SubBucketCount + static_cast<std::size_t>(value >> shift) - SubBucketCount;
+    }
+
+    template <unsigned SubBucketBits, unsigned MaxBits>
+    inline std::uint64_t LatencyHistogram<SubBucketBits, MaxBits>::UpperBound(std::size_t bucket) noexcept
+    {
+        if (bucket < SubBucketCount)
+            return bucket;
+        const std::size_t shift = bucket / SubBucketCount - 1;
+        const std::uint64_t lower = static_cast<std::uint64_t>(SubBucketCount + bucket % SubBucketCount) << shift;
+        return lower + (std::uint64_t(1) << shift) - 1;
+    }
+
+    template <unsigned SubBucketBits, unsigned MaxBits>
+    inline void LatencyHistogram<SubBucketBits, MaxBits>::Record(std::uint64_t value) noexcept
+    {
+        ++mCounts[BucketOf(value)];
+        ++mCount;
+        if (value > mMax)
+            mMax = value;
+    }
+
+    template <unsigned SubBucketBits, unsigned MaxBits>
+    inline std::uint64_t LatencyHistogram<SubBucketBits, MaxBits>::Percentile(double fraction) const noexcept
+    {
+        if (mCount == 0)
+            return 0;
+        // Rank of the sample sought, at least the first one
+        const double exact = fraction * static_cast<double>(mCount);
+        std::uint64_t rank = static_cast<std::uint64_t>(exact);
+        if (static_cast<double>(rank) < exact || rank == 0)
+            ++rank;
+
+        std::uint64_t seen = 0;
+        for (std::size_t b = 0; b < BucketCount; ++b)
+        {
+            seen += mCounts[b];
+            if (seen >= rank)
+                return UpperBound(b) < mMax ? UpperBound(b) : mMax;
+        }
+        return mMax;
+    }
+
+    template <unsigned SubBucketBits, unsigned MaxBits>
+    inline void LatencyHistogram<SubBucketBits, MaxBits>::Reset() noexcept
+    {
+        for (std::size_t b = 0; b < BucketCount; ++b)
+            mCounts[b] = 0;
+        mCount = 0;
+        mMax = 0;
+    }
+
+    ///==============================================================
+    ///= LatencyTable
+    ///==============================================================
+    // One histogram of clock ticks per flattened transition of the model,
+    // and so per (state, event, next state) triple. A LatencyHistogram<> is
+    // about 2.4KB, so a table weighs that much times the transition count
+    template <class Model>
+    class LatencyTable
+    {
+        public:
+            using StateId = typename Model::StateId;
+            using Histogram = LatencyHistogram<>;
+
+            /// Records the ticks taken by the transition from prev to next on Event
+            template <class Event>
+            void Record(StateId prev, StateId next, std::uint64_t ticks) noexcept
+            {
+                mHistograms[RowOf<Event>(prev, next)].Record(ticks);
+            }
+
+            /// The histogram of the given transition, in the flattened table of the model
+            const Histogram& GetHistogram(std::size_t transition) const noexcept { return mHistograms[transition]; }
+
+            /// The histogram of the transition from Prev to Next on Event
+            template <class Prev, class Event, class Next>
+            const Histogram& GetHistogram() const noexcept
+            {
+                return mHistograms[RowOf<Event>(static_cast<StateId>(Model::template StateIndex<Prev>()),
+                                                Model::template StateIndex<Next>())];
+            }
+
+            /// Calls fn(state, event, next, histogram) with the dense indices of
+            /// every transition that was timed at least once
+            template <class Fn>
+            void ForEach(Fn fn) const;
+
+            /// Writes the sample count and the 50th, 90th, 99th and 99.9th
+            /// percentiles and the maximum of every timed transition, one per line
+            void Dump(std::ostream& out) const;
+
+            /// Forgets every sample
+            void Reset() noexcept;
+
+        private:
+            using Rows = typename Model::Rows;
+
+            /// Finds the flattened transition of the given triple, starting from the row
+            /// the dispatch policy of the model finds. Only rows after failed guards need
+            /// more than that lookup, and only history targets, whose next state is only
+            /// known at runtime, fall back to the first candidate
+            template <class Event>
+            static std::size_t RowOf(StateId state, std::size_t next) noexcept;
+
+            Histogram mHistograms[Model::TransitionCount];
+    };
+
+    template <class Model>
+    template <class Event>
+    inline std::size_t LatencyTable<Model>::RowOf(StateId state, std::size_t next) noexcept
+    {
+        const std::size_t event = Model::template EventIndex<Event>();
+        const std::size_t first = Model::template FindTransition<Event>(state);
+        for (std::size_t row = first; row < Rows::RowCount; ++row)
+            if (Rows::KeyAt(row).state == state && Rows::KeyAt(row).event == event && Rows::KeyAt(row).next == next)
+                return row;
+        return first;
+    }
+
+    template <class Model>
+    template <class Fn>
+    inline void LatencyTable<Model>::ForEach(Fn fn) const
+    {
+        for (std::size_t row = 0; row < Rows::RowCount; ++row)
+            if (mHistograms[row].Count() != 0)
+                fn(Rows::KeyAt(row).state, Rows::KeyAt(row).event, Rows::KeyAt(row).next, mHistograms[row]);
+    }
+
+    template <class Model>
+    inline void LatencyTable<Model>::Dump(std::ostream& out) const
+    {
+        ForEach([&out](std::size_t state, std::size_t event, std::size_t next, const Histogram& h)
+        {
+            out << "state " << state << " --event " << event << "--> state " << next
+                << ": count " << h.Count()
+                << ", p50 " << h.Percentile(0.5)
+                << ", p90 " << h.Percentile(0.9)
+                << ", p99 " << h.Percentile(0.99)
+                << ", p99.9 " << h.Percentile(0.999)
+                << ", max " << h.Max() << '\n';
+        });
+    }
+
+    template <class Model>
+    inline void LatencyTable<Model>::Reset() noexcept
+    {
+        for (std::size_t row = 0; row < Model::TransitionCount; ++row)
+            mHistograms[row].Reset();
+    }
+
+    ///==============================================================
+    ///= LatencyObserver
+    ///==============================================================
+    // Observer policy timing every transition with the given Clock, from
+    // right before the lookup to right after the entry hooks, so mostly
+    // the exit hooks and the action. Each machine embeds its own table of
+    // histograms, which costs about 2.4KB per transition of the model: use
+    // BasicSharedLatencyObserver for fleets of observed machines. Unhandled
+    // and deferred events are not timed
+    template <class Model, class Clock>
+    class BasicLatencyObserver : public LatencyTable<Model>
+    {
+        public:
+            using StateId = typename Model::StateId;
+            using Table = LatencyTable<Model>;
+
+            BasicLatencyObserver() noexcept : mStart(0) {}
+
+            template <class Event>
+            void OnDispatch(StateId) noexcept { mStart = Clock::Now(); }
+
+            template <class Event>
+            void OnTransition(StateId prev, StateId next) noexcept
+            {
+                const std::uint64_t end = Clock::Now();
+                Table::template Record<Event>(prev, next, end > mStart ? end - mStart : 0);
+            }
+
+            template <class Event>
+            void OnUnhandled(StateId) noexcept {}
+
+            template <class Event>
+            void OnDeferred(StateId) noexcept {}
+
+            void OnStateEntered(StateId) noexcept {}
+
+            void OnStateLeft(StateId) noexcept {}
+
+        private:
+            std::uint64_t mStart;
+    };
+
+    ///==============================================================
+    ///= SharedLatencyObserver
+    ///==============================================================
+    // Same as above, recording into a table kept outside of the machine,
+    // which then only grows by two words. Machines sharing a table must be
+    // dispatched from the same thread, a table per thread or per registry
+    // shard being the usual layout. Machines without a table time nothing
+    template <class Model, class Clock>
+    class BasicSharedLatencyObserver
+    {
+        public:
+            using StateId = typename Model::StateId;
+            using Table = LatencyTable<Model>;
+
+            BasicSharedLatencyObserver() noexcept : mTable(nullptr), mStart(0) {}
+
+            template <class Event>
+            void OnDispatch(StateId) noexcept
+            {
+                if (mTable)
+                    mStart = Clock::Now();
+            }
+
+            template <class Event>
+            void OnTransition(StateId prev, StateId next) noexcept
+            {
+                if (!mTable)
+                    return;
+                const std::uint64_t end = Clock::Now();
+                mTable->template Record<Event>(prev, next, end > mStart ? end - mStart : 0);
+            }
+
+            template <class Event>
+            void OnUnhandled(StateId) noexcept {}
+
+            template <class Event>
+            void OnDeferred(StateId) noexcept {}
+
+            void OnStateEntered(StateId) noexcept {}
+
+            void OnStateLeft(StateId) noexcept {}
+
+            /// The table the machine records into, or nullptr
+            Table* GetTable() const noexcept { return mTable; }
+
+            void SetTable(Table* table) noexcept { mTable = table; }
+
+        private:
+            Table* mTable;
+            std::uint64_t mStart;
+    };
+
+    /// The latency observer policy timing with the cheapest clock of the platform.
+    /// Other clocks are picked through an alias of BasicLatencyObserver like this one
+    template <class Model>
+    using LatencyObserver = BasicLatencyObserver<Model, LatencyClock>;
+
+    /// The shared table flavour of the above
+    template <class Model>
+    using SharedLatencyObserver = BasicSharedLatencyObserver<Model, LatencyClock>;
+}
+
+#endif // ! _LATENCY_OBSERVER_HPP_
@@ -0,0 +1,216 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#ifndef _MAILBOX_HPP_
+#define _MAILBOX_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace Gearless
+{
+    ///==============================================================
+    ///= Mailbox
+    ///==============================================================
+    // Bounded lock-free multi producer / single consumer event queue in
+    // front of a machine. Any number of threads may post events, while a
+    // single consumer thread drains them through the machine's ProcessEvent.
+    // Events are type erased into fixed size inline slots, so posting never
+    // allocates. Each slot carries a sequence number which tells producers
+    // and the consumer whose turn it is, as in D. Vyukov's bounded queue
+    template <class Machine, std::size_t Capacity = 1024, std::size_t InlineSize = 64>
+    class Mailbox
+    {
+        static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Mailbox capacity must be a power of two");
+
+        public:
+            /// The largest event size that fits in a slot
+            static constexpr std::size_t MaxEventSize = InlineSize;
+
+            Mailbox();
+            ~Mailbox();
+
+            Mailbox(const Mailbox&) = delete;
+            Mailbox& operator=(const Mailbox&) = delete;
+
+            /// Enqueues a copy of the event, may be called from any thread.
+            /// Returns false without blocking if the mailbox is full
+            template <class Event>
+            bool PostEvent(Event&& ev);
+
+            /// Dispatches up to max queued events to the given machine in posting
+            /// order and returns how many were dispatched. Consumer thread only
+            std::size_t Drain(Machine& machine, std::size_t max = static_cast<std::size_t>(-1));
+
+            /// Checks whether there is no event ready to be drained. Consumer thread only
+            bool Empty() const;
+
+        private:
+            using DispatchFn = void (*)(Machine&, void*);
+            using DestroyFn = void (*)(void*);
+
+            struct Slot
+            {
+                std::atomic<std::size_t> sequence;
+                DispatchFn dispatch;
+                DestroyFn destroy;
+                typename std::aligned_storage<InlineSize, alignof(std::max_align_t)>::type storage;
+            };
+
+            template <class Event>
+            static void DispatchAndDestroy(Machine& machine, void* p);
+
+            template <class Event>
+            static void Destroy(void* p);
+
+            static constexpr std::size_t Mask = Capacity - 1;
+            static constexpr std::size_t CacheLine = 64;
+
+            /// The ring of slots, allocated once on construction
+            std::unique_ptr<Slot[]> mSlots;
+
+            /// Next position to be claimed by producers, kept off the consumer's cache line
+            char mPad0[CacheLine];
+            std::atomic<std::size_t> mEnqueuePos;
+            char mPad1[CacheLine - sizeof(std::atomic<std::size_t>)];
+
+            /// Next position to be drained, only touched by the consumer
+            std::size_t mDequeuePos;
+            char mPad2[CacheLine - sizeof(std::size_t)];
+    };
+
+    template <class Machine, std::size_t Capacity, std::size_t InlineSize>
+    inline Mailbox<Machine, Capacity, InlineSize>::Mailbox()
+        : mSlots(new Slot[Capacity]), mEnqueuePos(0), mDequeuePos(0)
+    {
+        for (std::size_t i = 0; i < Capacity; ++i)
+            mSlots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    template <class Machine, std::size_t Capacity, std::size_t InlineSize>
+    inline Mailbox<Machine, Capacity, InlineSize>::~Mailbox()
+    {
+        // Destroy the events that were posted but never drained
+        for (;; ++mDequeuePos)
+        {
+            Slot& slot = mSlots[mDequeuePos & Mask];
+            if (slot.sequence.load(std::memory_order_acquire) != mDequeuePos + 1)
+                break;
+            slot.destroy(&slot.storage);
+        }
+    }
+
+    template <class Machine, std::size_t Capacity, std::size_t InlineSize>
+    template <class Event>
+    inline bool Mailbox<Machine, Capacity, InlineSize>::PostEvent(Event&& ev)
+    {
+        using E = typename std::decay<Event>::type;
+        static_assert(sizeof(E) <= InlineSize, "Event does not fit in a mailbox slot, raise the InlineSize");
+        static_assert(alignof(E) <= alignof(std::max_align_t), "Over-aligned events can not be stored in a mailbox");
+
+        Slot* slot;
+        std::size_t pos = mEnqueuePos.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            slot = &mSlots[pos & Mask];
+            const std::size_t seq = slot->sequence.load(std::memory_order_acquire);
+            const std::intptr_t diff = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+            if (diff == 0)
+            {
+                // The slot is free for this lap, try to claim the position
+                if (mEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+                return false; // The consumer has not freed the slot of the previous lap yet
+            else
+                pos = mEnqueuePos.load(std::memory_order_relaxed);
+        }
+
+        ::new (&slot->storage) E(std::forward<Event>(ev));
+        slot->dispatch = &DispatchAndDestroy<E>;
+        slot->destroy = &Destroy<E>;
+        // Publish the event to the consumer
+        slot->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    template <class Machine, std::size_t Capacity, std::size_t InlineSize>
+    inline std::size_t Mailbox<Machine, Capacity, InlineSize>::Drain(Machine& machine, std::size_t max)
+    {
+        std::size_t n = 0;
+        for (; n < max; ++n)
+        {
+            Slot& slot = mSlots[mDequeuePos & Mask];
+            if (slot.sequence.load(std::memory_order_acquire) != mDequeuePos + 1)
+                break;
+            // Hand the slot back to the producers of the next lap, even if the machine throws
+            struct Release
+            {
+                Slot& slot;
+                std::size_t next;
+                ~Release() { slot.sequence.store(next, std::memory_order_release); }
+            } release{slot, mDequeuePos + Capacity};
+            ++mDequeuePos;
+            slot.dispatch(machine, &slot.storage);
+        }
+        return n;
+    }
+
+    template <class Machine, std::size_t Capacity, std::size_t InlineSize>
+    inline bool Mailbox<Machine, Capacity, InlineSize>::Empty() const
+    {
+        const Slot& slot = mSlots[mDequeuePos & Mask];
+        return slot.sequence.load(std::memory_order_acquire) != mDequeuePos + 1;
+    }
+
+    template <class Machine, std::size_t Capacity, std::size_t InlineSize>
+    template <class Event>
+    inline void Mailbox<Machine, Capacity, InlineSize>::DispatchAndDestroy(Machine& machine, void* p)
+    {
+        Event* ev = static_cast<Event*>(p);
+        struct Guard { Event* ev; ~Guard() { ev->~Event(); } } guard{ev};
+        machine.ProcessEvent(*ev);
+    }
+
+    template <class Machine, std::size_t Capacity, std::size_t InlineSize>
+    template <class Event>
+    inline void Mailbox<Machine, Capacity, InlineSize>::Destroy(void* p)
+    {
+        static_cast<Event*>(p)->~Event();
+    }
+}
+
+#endif // ! _MAILBOX_HPP_
@@ -0,0 +1,150 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#ifndef _OBSERVER_HPP_
+#define _OBSERVER_HPP_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Gearless
+{
+    ///==============================================================
+    ///= NullObserver
+    ///==============================================================
+    // The observer policy of a state machine is a class template taking the
+    // machine's model. The machine keeps an instance of it as a base class
+    // and calls the hooks below with dense state indices around every
+    // dispatched event. A transition reports the state it left, then itself,
+    // then the state it entered; self transitions included, as they leave
+    // and enter their state again. The default observer has no data and
+    // only empty inline hooks, so it adds neither size nor code
+    template <class Model>
+    struct NullObserver
+    {
+        using StateId = typename Model::StateId;
+
+        /// An Event of the transition table is about to be dispatched in the given state
+        template <class Event>
+        void OnDispatch(StateId) noexcept {}
+
+        /// A transition fired on Event from prev to next
+        template <class Event>
+        void OnTransition(StateId, StateId) noexcept {}
+
+        /// No transition of the given state accepted the Event
+        template <class Event>
+        void OnUnhandled(StateId) noexcept {}
+
+        /// The given state deferred the Event
+        template <class Event>
+        void OnDeferred(StateId) noexcept {}
+
+        /// The given state was entered, by a transition or by Start
+        void OnStateEntered(StateId) noexcept {}
+
+        /// The given state was left, by a transition or by Stop
+        void OnStateLeft(StateId) noexcept {}
+    };
+
+    ///==============================================================
+    ///= CountingObserver
+    ///==============================================================
+    // Counts how many times every (state, event) pair fired a transition,
+    // laid out like the [state][event] jump table of the model, along with
+    // the entries of every state and the events deferred or left unhandled
+    template <class Model>
+    class CountingObserver
+    {
+        public:
+            using StateId = typename Model::StateId;
+
+            CountingObserver() noexcept { Reset(); }
+
+            template <class Event>
+            void OnDispatch(StateId) noexcept {}
+
+            template <class Event>
+            void OnTransition(StateId prev, StateId) noexcept { ++mHits[prev][Model::template EventIndex<Event>()]; }
+
+            template <class Event>
+            void OnUnhandled(StateId) noexcept { ++mUnhandled; }
+
+            template <class Event>
+            void OnDeferred(StateId) noexcept { ++mDeferred; }
+
+            void OnStateEntered(StateId state) noexcept { ++mEntries[state]; }
+
+            void OnStateLeft(StateId) noexcept {}
+
+            /// Number of transitions fired from the given state on the given event
+            std::uint64_t Hits(std::size_t state, std::size_t event) const noexcept { return mHits[state][event]; }
+
+            /// Same as above, with the indices resolved at compile time
+            template <class State, class Event>
+            std::uint64_t Hits() const noexcept
+            {
+                return Hits(Model::template StateIndex<State>(), Model::template EventIndex<Event>());
+            }
+
+            /// Number of times the given state was entered
+            std::uint64_t Entries(std::size_t state) const noexcept { return mEntries[state]; }
+
+            /// Number of events that no transition accepted
+            std::uint64_t Unhandled() const noexcept { return mUnhandled; }
+
+            /// Number of events deferred, replayed ones deferred again included
+            std::uint64_t Deferred() const noexcept { return mDeferred; }
+
+            /// Sets every count back to zero
+            void Reset() noexcept;
+
+        private:
+            std::uint64_t mHits[Model::StateCount][Model::EventCount];
+            std::uint64_t mEntries[Model::StateCount];
+            std::uint64_t mUnhandled;
+            std::uint64_t mDeferred;
+    };
+
+    template <class Model>
+    inline void CountingObserver<Model>::Reset() noexcept
+    {
+        for (std::size_t s = 0; s < Model::StateCount; ++s)
+        {
+            for (std::size_t e = 0; e < Model::EventCount; ++e)
+                mHits[s][e] = 0;
+            mEntries[s] = 0;
+        }
+        mUnhandled = 0;
+        mDeferred = 0;
+    }
+}
+
+#endif // ! _OBSERVER_HPP_
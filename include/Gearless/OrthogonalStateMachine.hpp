@@ -0,0 +1,273 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#ifndef _ORTHOGONAL_STATE_MACHINE_HPP_
+#define _ORTHOGONAL_STATE_MACHINE_HPP_
+
+#include <cstdint>
+#include <tuple>
+#include <Gearless/StateMachine.hpp>
+
+namespace Gearless
+{
+    ///==============================================================
+    ///= Region
+    ///==============================================================
+    // One of the independent sub-machines of an OrthogonalStateMachine
+    template <class Init, class TransitionsPack, class DispatchPolicy = DenseDispatch>
+    struct Region
+    {
+        using InitState = Init;
+        using Model = MachineModel<Init, TransitionsPack, DispatchPolicy>;
+    };
+
+    ///==============================================================
+    ///= RegionLayout
+    ///==============================================================
+    /// Number of bits needed to represent the given value
+    constexpr std::size_t BitWidth(std::size_t value)
+    {
+        return value == 0 ? 0 : 1 + BitWidth(value >> 1);
+    }
+
+    /// Value with the given number of low bits set
+    constexpr std::uint64_t LowBitsMask(std::size_t bits)
+    {
+        return bits >= 64 ? ~std::uint64_t(0) : (std::uint64_t(1) << bits) - 1;
+    }
+
+    // Bit fields of the region states packed into one integer, in region order
+    template <class... Models>
+    struct RegionLayout
+    {
+        static constexpr std::size_t widths[sizeof...(Models)] = { BitWidth(Models::StateCount - 1)... };
+
+        /// Returns the position of the lowest bit of the given region
+        static constexpr std::size_t Offset(std::size_t region)
+        {
+            return region == 0 ? 0 : Offset(region - 1) + widths[region - 1];
+        }
+    };
+
+    template <class... Models>
+    constexpr std::size_t RegionLayout<Models...>::widths[];
+
+    template <class Seq>
+    struct IndexPack;
+
+    template <std::size_t... Is>
+    struct IndexPack<IndexSeq<Is...>>
+    {
+        using type = Packer<std::integral_constant<std::size_t, Is>...>;
+    };
+
+    ///==============================================================
+    ///= OrthogonalStateMachine
+    ///==============================================================
+    // A machine made of independent regions that are all active at once.
+    // The current states of every region are packed into the bit fields of
+    // a single integer, and each event type is dispatched through a compile
+    // time list of the regions handling it, without visiting the others
+    template <class... Regions>
+    class OrthogonalStateMachine
+    {
+        static_assert(sizeof...(Regions) > 0, "An orthogonal state machine needs at least one region");
+
+        public:
+            static constexpr std::size_t RegionCount = sizeof...(Regions);
+
+            /// The compile time description of the given region
+            template <std::size_t I>
+            using RegionModel = typename std::tuple_element<I, std::tuple<typename Regions::Model...>>::type;
+
+            /// The deduplicated events handled by at least one region
+            using Events = typename PackUnique<typename PackConcat<typename Regions::Model::Events...>::type>::type;
+
+        private:
+            using Layout = RegionLayout<typename Regions::Model...>;
+
+        public:
+            /// Number of bits taken by the states of all regions
+            static constexpr std::size_t StateBits = Layout::Offset(RegionCount);
+            static_assert(StateBits <= 64, "The region states do not fit in 64 bits");
+
+            /// The narrowest unsigned integer able to hold the packed region states
+            using StateId = typename SmallestUInt<LowBitsMask(StateBits)>::type;
+
+            /// Constructs the machine with every region in its initial state
+            constexpr OrthogonalStateMachine() noexcept : mState(0) {}
+
+            /// Enters the initial state of every region
+            void Start();
+
+            /// Leaves the current state of every region
+            void Stop();
+
+            /// Dispatches the event to the regions that handle it, in region order
+            template <class Event>
+            void ProcessEvent(const Event& ev);
+
+            /// Checks whether the region owning the given state is in it
+            template <class State>
+            bool IsInState() const noexcept;
+
+            /// Retrieves the current state index of the given region
+            template <std::size_t I>
+            typename RegionModel<I>::StateId GetRegionState() const noexcept
+            {
+                return static_cast<typename RegionModel<I>::StateId>((mState >> Offset<I>()) & Mask<I>());
+            }
+
+            /// Retrieves the packed states of every region
+            StateId GetState() const noexcept { return mState; }
+
+            /// Restores packed states previously obtained through GetState
+            void RestoreState(StateId state) noexcept { mState = state; }
+
+        private:
+            template <std::size_t I>
+            static constexpr std::size_t Offset() { return Layout::Offset(I); }
+
+            template <std::size_t I>
+            static constexpr StateId Mask() { return static_cast<StateId>(LowBitsMask(Layout::widths[I])); }
+
+            using RegionIndices = typename IndexPack<typename MakeIndexSeq<RegionCount>::type>::type;
+
+            template <class Event>
+            struct HandledBy
+            {
+                template <class Index>
+                struct Pred : PackContains<Event, typename RegionModel<Index::value>::Events> {};
+            };
+
+            template <class State>
+            struct OwnedBy
+            {
+                template <class Index>
+                struct Pred : std::integral_constant<bool,
+                    PackContains<State, typename RegionModel<Index::value>::States>::value ||
+                    PackContains<State, typename RegionModel<Index::value>::Composites>::value> {};
+            };
+
+            template <std::size_t I>
+            void SetRegionState(typename RegionModel<I>::StateId state) noexcept
+            {
+                mState = static_cast<StateId>((mState & ~(Mask<I>() << Offset<I>())) | (static_cast<StateId>(state) << Offset<I>()));
+            }
+
+            template <std::size_t I, class Event>
+            void DispatchRegion(const Event& ev);
+
+            template <class Event, class... Indices>
+            void DispatchRegions(const Event& ev, Packer<Indices...>);
+
+            template <class... Indices>
+            void StartRegions(Packer<Indices...>);
+
+            template <class... Indices>
+            void StopRegions(Packer<Indices...>);
+
+            /// The current state of every region, in its own bit field
+            StateId mState;
+    };
+
+    template <class... Regions>
+    constexpr std::size_t OrthogonalStateMachine<Regions...>::RegionCount;
+
+    template <class... Regions>
+    constexpr std::size_t OrthogonalStateMachine<Regions...>::StateBits;
+
+    template <class... Regions>
+    inline void OrthogonalStateMachine<Regions...>::Start()
+    {
+        // The initial leaf of every region has index 0
+        mState = 0;
+        StartRegions(RegionIndices());
+    }
+
+    template <class... Regions>
+    inline void OrthogonalStateMachine<Regions...>::Stop()
+    {
+        StopRegions(RegionIndices());
+    }
+
+    template <class... Regions>
+    template <class Event>
+    inline void OrthogonalStateMachine<Regions...>::ProcessEvent(const Event& ev)
+    {
+        DispatchRegions(ev, typename PackFilter<HandledBy<Event>::template Pred, RegionIndices>::type());
+    }
+
+    template <class... Regions>
+    template <class State>
+    inline bool OrthogonalStateMachine<Regions...>::IsInState() const noexcept
+    {
+        using Owners = typename PackFilter<OwnedBy<typename remove_all<State>::type>::template Pred, RegionIndices>::type;
+        static_assert(PackSize<Owners>::value == 1, "The given state must belong to exactly one region");
+        using Owner = typename PackFront<Owners>::type;
+        return RegionModel<Owner::value>::template InState<State>(GetRegionState<Owner::value>());
+    }
+
+    template <class... Regions>
+    template <std::size_t I, class Event>
+    inline void OrthogonalStateMachine<Regions...>::DispatchRegion(const Event& ev)
+    {
+        typename RegionModel<I>::StateId state = GetRegionState<I>();
+        RegionModel<I>::Dispatch(state, ev);
+        SetRegionState<I>(state);
+    }
+
+    template <class... Regions>
+    template <class Event, class... Indices>
+    inline void OrthogonalStateMachine<Regions...>::DispatchRegions(const Event& ev, Packer<Indices...>)
+    {
+        using Sequence = int[];
+        (void)Sequence{ 0, (DispatchRegion<Indices::value>(ev), 0)... };
+    }
+
+    template <class... Regions>
+    template <class... Indices>
+    inline void OrthogonalStateMachine<Regions...>::StartRegions(Packer<Indices...>)
+    {
+        using Sequence = int[];
+        (void)Sequence{ 0, (HookCalls<StartEntries<typename InitialLeaf<
+            typename std::tuple_element<Indices::value, std::tuple<Regions...>>::type::InitState>::type>>::Enter(), 0)... };
+    }
+
+    template <class... Regions>
+    template <class... Indices>
+    inline void OrthogonalStateMachine<Regions...>::StopRegions(Packer<Indices...>)
+    {
+        using Sequence = int[];
+        (void)Sequence{ 0, (StopCascade<typename RegionModel<Indices::value>::States>::Exit(GetRegionState<Indices::value>()), 0)... };
+    }
+}
+
+#endif // ! _ORTHOGONAL_STATE_MACHINE_HPP_
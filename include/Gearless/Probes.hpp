@@ -0,0 +1,69 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#ifndef _PROBES_HPP_
+#define _PROBES_HPP_
+
+///==============================================================
+///= Static tracepoints
+///==============================================================
+// USDT probes of the "gearless" provider, compiled in only when
+// GEARLESS_USDT is defined and <sys/sdt.h> (systemtap-sdt-dev) is
+// available. Each probe is a single nop until a tracer attaches to it,
+// for instance:
+//
+//   bpftrace -e 'usdt:./app:gearless:process_event { @[arg1, arg2, arg3] = count(); }'
+//
+// lists the hot (state, event, next state) triples of a running process.
+// The probes and their arguments are:
+//
+//   gearless:start         (machine, state)
+//   gearless:stop          (machine, state)
+//   gearless:process_event (machine, state, event, next state, result)
+//
+// where machine is the address of the StateMachine, states and events are
+// the dense indices of its model (EventCount for events outside the table)
+// and result is the EventResult of the dispatch. Without GEARLESS_USDT the
+// probes expand to nothing and their arguments are not evaluated. Builds
+// that define DTRACE_PROBE2 and DTRACE_PROBE5 themselves, like the tests,
+// do not need <sys/sdt.h>
+#if defined(GEARLESS_USDT)
+#if !defined(DTRACE_PROBE2) || !defined(DTRACE_PROBE5)
+#include <sys/sdt.h>
+#endif
+
+#define GEARLESS_PROBE2(name, a1, a2) DTRACE_PROBE2(gearless, name, a1, a2)
+#define GEARLESS_PROBE5(name, a1, a2, a3, a4, a5) DTRACE_PROBE5(gearless, name, a1, a2, a3, a4, a5)
+#else
+#define GEARLESS_PROBE2(name, a1, a2) ((void)0)
+#define GEARLESS_PROBE5(name, a1, a2, a3, a4, a5) ((void)0)
+#endif
+
+#endif // ! _PROBES_HPP_
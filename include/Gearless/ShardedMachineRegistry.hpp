@@ -0,0 +1,391 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#ifndef _SHARDED_MACHINE_REGISTRY_HPP_
+#define _SHARDED_MACHINE_REGISTRY_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Gearless
+{
+    // Finalizer of MurmurHash3, spreads std::hash results that are often the
+    // identity for integral keys over all the bits used to pick shards and slots
+    inline std::uint64_t MixHash(std::uint64_t h) noexcept
+    {
+        h ^= h >> 33;
+        h *= 0xff51afd7ed558ccdULL;
+        h ^= h >> 33;
+        h *= 0xc4ceb9fe1a85ec53ULL;
+        h ^= h >> 33;
+        return h;
+    }
+
+    ///==============================================================
+    ///= CacheLineAllocator
+    ///==============================================================
+    // Allocates arrays that start on a cache line boundary and are padded up
+    // to the next one, so that no other allocation shares a line with them
+    template <class T>
+    struct CacheLineAllocator
+    {
+        using value_type = T;
+
+        static constexpr std::size_t CacheLine = 64;
+
+        CacheLineAllocator() noexcept {}
+
+        template <class U>
+        CacheLineAllocator(const CacheLineAllocator<U>&) noexcept {}
+
+        T* allocate(std::size_t n);
+        void deallocate(T* p, std::size_t) noexcept;
+
+        template <class U>
+        bool operator==(const CacheLineAllocator<U>&) const noexcept { return true; }
+
+        template <class U>
+        bool operator!=(const CacheLineAllocator<U>&) const noexcept { return false; }
+    };
+
+    template <class T>
+    constexpr std::size_t CacheLineAllocator<T>::CacheLine;
+
+    template <class T>
+    inline T* CacheLineAllocator<T>::allocate(std::size_t n)
+    {
+        static_assert(alignof(T) <= CacheLine, "Over-aligned types can not be allocated on cache lines");
+        // Room for the padded array, the alignment slack and the pointer to free, kept right before the array
+        const std::size_t bytes = (n * sizeof(T) + CacheLine - 1) / CacheLine * CacheLine;
+        char* raw = static_cast<char*>(::operator new(bytes + CacheLine - 1 + sizeof(void*)));
+        const std::uintptr_t first = reinterpret_cast<std::uintptr_t>(raw + sizeof(void*));
+        char* aligned = raw + sizeof(void*) + ((CacheLine - first % CacheLine) % CacheLine);
+        reinterpret_cast<void**>(aligned)[-1] = raw;
+        return reinterpret_cast<T*>(aligned);
+    }
+
+    template <class T>
+    inline void CacheLineAllocator<T>::deallocate(T* p, std::size_t) noexcept
+    {
+        ::operator delete(reinterpret_cast<void**>(p)[-1]);
+    }
+
+    ///==============================================================
+    ///= ShardedMachineRegistry
+    ///==============================================================
+    // Maps keys to machines through a power of two number of shards. The high
+    // bits of the key hash pick the shard and the low bits the slot inside its
+    // open addressing table, so all the keys of a shard, and the machines next
+    // to them, are only touched by the thread owning that shard. Shard headers
+    // are spaced more than a cache line apart and the slot arrays of the shards
+    // are allocated on lines of their own, so that owners never share lines.
+    // Entries are constructed in place and relocated by move construction, so
+    // keys only need to be copy constructible and machines default and move
+    // constructible
+    template <class Key, class Machine, class Hash = std::hash<Key>, class KeyEqual = std::equal_to<Key>>
+    class ShardedMachineRegistry
+    {
+        static_assert(std::is_copy_constructible<Key>::value, "Registry keys must be copy constructible");
+        static_assert(std::is_default_constructible<Machine>::value,
+                      "Registry machines must be default constructible, as Insert creates them");
+        static_assert(std::is_move_constructible<Machine>::value,
+                      "Registry machines must be move constructible, as growing and erasing relocate them");
+
+        public:
+            ///==========================================================
+            ///= Shard
+            ///==========================================================
+            // Linear probing table of key and machine pairs, kept at most 3/4 full.
+            // Erasing shifts the following entries back instead of leaving tombstones
+            class Shard
+            {
+                public:
+                    Shard() : mSize(0) {}
+                    ~Shard();
+
+                    Shard(const Shard&) = delete;
+                    Shard& operator=(const Shard&) = delete;
+
+                    /// Retrieves the machine of the given key or nullptr. The pointer stays
+                    /// valid until the next insertion into or erasure from the shard, as both
+                    /// may move the machines of the shard
+                    Machine* Find(const Key& key, std::uint64_t hash);
+
+                    /// Retrieves the machine of the given key, default constructing it if absent
+                    Machine& Insert(const Key& key, std::uint64_t hash);
+
+                    /// Removes the given key, returns false if it was absent
+                    bool Erase(const Key& key, std::uint64_t hash);
+
+                    /// Number of machines in the shard
+                    std::size_t Size() const noexcept { return mSize; }
+
+                    /// Calls fn(key, machine) for every machine of the shard
+                    template <class Fn>
+                    void ForEach(Fn fn);
+
+                private:
+                    struct Entry
+                    {
+                        Key key;
+                        Machine machine;
+
+                        explicit Entry(const Key& k) : key(k), machine() {}
+                    };
+
+                    // Raw storage for an entry, only constructed while used
+                    struct Slot
+                    {
+                        typename std::aligned_storage<sizeof(Entry), alignof(Entry)>::type storage;
+                        bool used;
+
+                        Slot() noexcept : used(false) {}
+
+                        Entry& Get() noexcept { return *reinterpret_cast<Entry*>(&storage); }
+                        const Entry& Get() const noexcept { return *reinterpret_cast<const Entry*>(&storage); }
+                    };
+
+                    std::size_t Mask() const noexcept { return mSlots.size() - 1; }
+                    std::size_t Locate(const Key& key, std::uint64_t hash) const;
+                    void Grow();
+
+                    /// Moves the entry of the used src slot into the empty dst slot, emptying src
+                    static void Relocate(Slot& dst, Slot& src);
+
+                    std::vector<Slot, CacheLineAllocator<Slot>> mSlots;
+                    std::size_t mSize;
+            };
+
+            /// Creates the registry with the given power of two number of shards
+            explicit ShardedMachineRegistry(std::size_t shardCount = 1);
+
+            /// Retrieves the number of shards
+            std::size_t ShardCount() const noexcept { return mShards.size(); }
+
+            /// Retrieves the shard owning the given key
+            std::size_t ShardOf(const Key& key) const { return ShardOfHash(HashOf(key)); }
+
+            /// Direct access to a shard, for its owning thread
+            Shard& GetShard(std::size_t shard) { return mShards[shard].shard; }
+
+            /// Retrieves the machine of the given key or nullptr. The pointer stays valid
+            /// until the next insertion into or erasure from the shard of the key
+            Machine* Find(const Key& key);
+
+            /// Retrieves the machine of the given key, default constructing it if absent
+            Machine& Insert(const Key& key);
+
+            /// Removes the given key, returns false if it was absent
+            bool Erase(const Key& key);
+
+            /// Dispatches the event to the machine of the given key, returns false if absent
+            template <class Event>
+            bool ProcessEvent(const Key& key, const Event& ev);
+
+            /// Total number of machines, only meaningful while no shard is being modified
+            std::size_t Size() const;
+
+        private:
+            static constexpr std::size_t CacheLine = 64;
+
+            struct PaddedShard
+            {
+                Shard shard;
+                char pad[2 * CacheLine - sizeof(Shard) % CacheLine];
+            };
+
+            std::uint64_t HashOf(const Key& key) const { return MixHash(static_cast<std::uint64_t>(Hash()(key))); }
+            std::size_t ShardOfHash(std::uint64_t hash) const noexcept
+            {
+                return mShardBits == 0 ? 0 : static_cast<std::size_t>(hash >> (64 - mShardBits));
+            }
+
+            std::vector<PaddedShard> mShards;
+            unsigned mShardBits;
+    };
+
+    template <class Key, class Machine, class Hash, class KeyEqual>
+    inline std::size_t ShardedMachineRegistry<Key, Machine, Hash, KeyEqual>::Shard::Locate(const Key& key, std::uint64_t hash) const
+    {
+        // Returns the slot holding the key, or the empty slot ending its probe sequence
+        std::size_t i = static_cast<std::size_t>(hash) & Mask();
+        while (mSlots[i].used && !KeyEqual()(mSlots[i].Get().key, key))
+            i = (i + 1) & Mask();
+        return i;
+    }
+
+    template <class Key, class Machine, class Hash, class KeyEqual>
+    inline Machine* ShardedMachineRegistry<Key, Machine, Hash, KeyEqual>::Shard::Find(const Key& key, std::uint64_t hash)
+    {
+        if (mSize == 0)
+            return nullptr;
+        Slot& slot = mSlots[Locate(key, hash)];
+        return slot.used ? &slot.Get().machine : nullptr;
+    }
+
+    template <class Key, class Machine, class Hash, class KeyEqual>
+    inline Machine& ShardedMachineRegistry<Key, Machine, Hash, KeyEqual>::Shard::Insert(const Key& key, std::uint64_t hash)
+    {
+        if ((mSize + 1) * 4 > mSlots.size() * 3)
+            Grow();
+        Slot& slot = mSlots[Locate(key, hash)];
+        if (!slot.used)
+        {
+            ::new (&slot.storage) Entry(key);
+            slot.used = true;
+            ++mSize;
+        }
+        return slot.Get().machine;
+    }
+
+    template <class Key, class Machine, class Hash, class KeyEqual>
+    inline bool ShardedMachineRegistry<Key, Machine, Hash, KeyEqual>::Shard::Erase(const Key& key, std::uint64_t hash)
+    {
+        if (mSize == 0)
+            return false;
+        std::size_t hole = Locate(key, hash);
+        if (!mSlots[hole].used)
+            return false;
+        mSlots[hole].Get().~Entry();
+        mSlots[hole].used = false;
+
+        // Shift back every following entry whose home slot is not between the hole and itself
+        for (std::size_t i = (hole + 1) & Mask(); mSlots[i].used; i = (i + 1) & Mask())
+        {
+            const std::size_t home = static_cast<std::size_t>(MixHash(static_cast<std::uint64_t>(Hash()(mSlots[i].Get().key)))) & Mask();
+            if (((i - home) & Mask()) >= ((i - hole) & Mask()))
+            {
+                Relocate(mSlots[hole], mSlots[i]);
+                hole = i;
+            }
+        }
+        --mSize;
+        return true;
+    }
+
+    template <class Key, class Machine, class Hash, class KeyEqual>
+    template <class Fn>
+    inline void ShardedMachineRegistry<Key, Machine, Hash, KeyEqual>::Shard::ForEach(Fn fn)
+    {
+        for (Slot& slot : mSlots)
+            if (slot.used)
+                fn(static_cast<const Key&>(slot.Get().key), slot.Get().machine);
+    }
+
+    template <class Key, class Machine, class Hash, class KeyEqual>
+    inline void ShardedMachineRegistry<Key, Machine, Hash, KeyEqual>::Shard::Grow()
+    {
+        std::vector<Slot, CacheLineAllocator<Slot>> old(mSlots.empty() ? 16 : mSlots.size() * 2);
+        old.swap(mSlots);
+        for (Slot& slot : old)
+        {
+            if (slot.used)
+            {
+                const std::uint64_t hash = MixHash(static_cast<std::uint64_t>(Hash()(slot.Get().key)));
+                Relocate(mSlots[Locate(slot.Get().key, hash)], slot);
+            }
+        }
+    }
+
+    template <class Key, class Machine, class Hash, class KeyEqual>
+    inline void ShardedMachineRegistry<Key, Machine, Hash, KeyEqual>::Shard::Relocate(Slot& dst, Slot& src)
+    {
+        ::new (&dst.storage) Entry(std::move(src.Get()));
+        dst.used = true;
+        src.Get().~Entry();
+        src.used = false;
+    }
+
+    template <class Key, class Machine, class Hash, class KeyEqual>
+    inline ShardedMachineRegistry<Key, Machine, Hash, KeyEqual>::Shard::~Shard()
+    {
+        for (Slot& slot : mSlots)
+            if (slot.used)
+                slot.Get().~Entry();
+    }
+
+    template <class Key, class Machine, class Hash, class KeyEqual>
+    inline ShardedMachineRegistry<Key, Machine, Hash, KeyEqual>::ShardedMachineRegistry(std::size_t shardCount)
+        : mShards(shardCount), mShardBits(0)
+    {
+        assert(shardCount != 0 && (shardCount & (shardCount - 1)) == 0 && "Shard count must be a power of two");
+        while ((std::size_t(1) << mShardBits) < shardCount)
+            ++mShardBits;
+    }
+
+    template <class Key, class Machine, class Hash, class KeyEqual>
+    inline Machine* ShardedMachineRegistry<Key, Machine, Hash, KeyEqual>::Find(const Key& key)
+    {
+        const std::uint64_t hash = HashOf(key);
+        return mShards[ShardOfHash(hash)].shard.Find(key, hash);
+    }
+
+    template <class Key, class Machine, class Hash, class KeyEqual>
+    inline Machine& ShardedMachineRegistry<Key, Machine, Hash, KeyEqual>::Insert(const Key& key)
+    {
+        const std::uint64_t hash = HashOf(key);
+        return mShards[ShardOfHash(hash)].shard.Insert(key, hash);
+    }
+
+    template <class Key, class Machine, class Hash, class KeyEqual>
+    inline bool ShardedMachineRegistry<Key, Machine, Hash, KeyEqual>::Erase(const Key& key)
+    {
+        const std::uint64_t hash = HashOf(key);
+        return mShards[ShardOfHash(hash)].shard.Erase(key, hash);
+    }
+
+    template <class Key, class Machine, class Hash, class KeyEqual>
+    template <class Event>
+    inline bool ShardedMachineRegistry<Key, Machine, Hash, KeyEqual>::ProcessEvent(const Key& key, const Event& ev)
+    {
+        Machine* machine = Find(key);
+        if (!machine)
+            return false;
+        machine->ProcessEvent(ev);
+        return true;
+    }
+
+    template <class Key, class Machine, class Hash, class KeyEqual>
+    inline std::size_t ShardedMachineRegistry<Key, Machine, Hash, KeyEqual>::Size() const
+    {
+        std::size_t size = 0;
+        for (const PaddedShard& s : mShards)
+            size += s.shard.Size();
+        return size;
+    }
+}
+
+#endif // ! _SHARDED_MACHINE_REGISTRY_HPP_
@@ -31,165 +31,807 @@
 #ifndef _STATE_MACHINE_HPP_
 #define _STATE_MACHINE_HPP_
 
-#include <memory>
-#include <vector>
-#include <tuple>
+#include <cassert>
+#include <limits>
 #include <Gearless/TypeId.hpp>
+#include <Gearless/TypeList.hpp>
+#include <Gearless/DeferredQueue.hpp>
+#include <Gearless/Dispatch.hpp>
+#include <Gearless/Hierarchy.hpp>
+#include <Gearless/History.hpp>
+#include <Gearless/Observer.hpp>
+#include <Gearless/Probes.hpp>
+#include <Gearless/UnhandledPolicy.hpp>
 
 namespace Gearless
 {
-    ///==============================================================
-    ///= Packer
-    ///==============================================================
-    template <class... Types>
-    struct Packer {};
-
     ///==============================================================
     ///= TFunct
     ///==============================================================
+    // Binds a free function as a transition action through a non-type
+    // template parameter, so every call site is a direct (inlinable) call
     template <class Ev, void(Fn)(const Ev&)>
     struct TFunct
     {
-        using FPtr = void(*)(const Ev&);
-        static FPtr f;
+        static void Call(const Ev& ev) { Fn(ev); }
     };
 
-    template <class Ev, void(Fn)(const Ev&)>
-    typename TFunct<Ev, Fn>::FPtr TFunct<Ev, Fn>::f = Fn;
+    ///==============================================================
+    ///= NoAction
+    ///==============================================================
+    struct NoAction
+    {
+        template <class Ev>
+        static void Call(const Ev&) {}
+    };
+
+    ///==============================================================
+    ///= TGuard
+    ///==============================================================
+    // Binds a free predicate as a transition guard, like TFunct for actions
+    template <class Ev, bool(Fn)(const Ev&)>
+    struct TGuard
+    {
+        static bool Check(const Ev& ev) { return Fn(ev); }
+    };
+
+    ///==============================================================
+    ///= NoGuard
+    ///==============================================================
+    struct NoGuard
+    {
+        template <class Ev>
+        static constexpr bool Check(const Ev&) { return true; }
+    };
 
     ///==============================================================
     ///= Transition
     ///==============================================================
-    template <class Prev, class Ev, class Next, typename Fn>
+    // The action Fn can be either a type with a static Call(const Ev&)
+    // member (TFunct, NoAction) or a default constructible functor type.
+    // The guard Gd likewise has a static Check(const Ev&) member (TGuard,
+    // NoGuard) or is a functor type, and lets the transition fire only when
+    // it returns true. Otherwise the next transition declared for the same
+    // state and event is tried
+    template <class Prev, class Ev, class Next, typename Fn = NoAction, typename Gd = NoGuard>
     struct Transition
     {
         using PrevState = Prev;
         using Event = Ev;
         using NextState = Next;
         using TransFn = Fn;
+        using TransGuard = Gd;
     };
 
+    template <class Fn, class Event>
+    inline auto InvokeAction(const Event& ev, int) -> decltype(Fn::Call(ev), void())
+    {
+        Fn::Call(ev);
+    }
+
+    template <class Fn, class Event>
+    inline void InvokeAction(const Event& ev, long)
+    {
+        Fn()(ev);
+    }
+
+    template <class Gd, class Event>
+    inline auto InvokeGuard(const Event& ev, int) -> decltype(static_cast<bool>(Gd::Check(ev)))
+    {
+        return Gd::Check(ev);
+    }
+
+    template <class Gd, class Event>
+    inline bool InvokeGuard(const Event& ev, long)
+    {
+        return Gd()(ev);
+    }
+
+    /// Evaluates the guard of the given transition directly
+    template <class Transit>
+    inline bool InvokeGuard(const typename Transit::Event& ev)
+    {
+        return InvokeGuard<typename Transit::TransGuard>(ev, 0);
+    }
+
+    /// Calls the action of the given transition directly
+    template <class Transit>
+    inline void InvokeAction(const typename Transit::Event& ev)
+    {
+        InvokeAction<typename Transit::TransFn>(ev, 0);
+    }
+
+    /// Runs the exit hooks, the action and the entry hooks of the given flattened transition
+    template <class Transit>
+    inline void RunTransition(const typename Transit::Event& ev)
+    {
+        HookCalls<typename Transit::Exits>::Exit();
+        InvokeAction<Transit>(ev);
+        HookCalls<typename Transit::Entries>::Enter();
+    }
+
+    template <class States, class Transit, class StateId, class History>
+    inline void FireTransition(StateId& curState, History& history, const typename Transit::Event& ev, std::false_type)
+    {
+        RecordHistory<Transit>(history);
+        curState = static_cast<StateId>(TypeIndex<typename Transit::NextState, States>::value);
+        RunTransition<Transit>(ev);
+    }
+
+    template <class States, class Transit, class StateId, class History>
+    inline void FireTransition(StateId& curState, History& history, const typename Transit::Event& ev, std::true_type)
+    {
+        // Record first, so that leaving and re-entering a composite restores where it was left
+        RecordHistory<Transit>(history);
+        curState = static_cast<StateId>(RestoreHistory<typename Transit::Restores>(history));
+        RunTransition<Transit>(ev);
+        RestoredEntries<typename Transit::Entered, States>::Enter(curState);
+    }
+
+    /// Moves to the next state of the given flattened transition and runs it
+    template <class States, class Transit, class StateId, class History>
+    inline void FireTransition(StateId& curState, History& history, const typename Transit::Event& ev)
+    {
+        FireTransition<States, Transit>(curState, history, ev,
+            std::integral_constant<bool, !std::is_void<typename Transit::Restores>::value>());
+    }
+
+    template <class States, class Transit, class StateId, class History>
+    inline EventResult FireRow(StateId& curState, History& history, const typename Transit::Event& ev, std::false_type)
+    {
+        FireTransition<States, Transit>(curState, history, ev);
+        return EventResult::Handled;
+    }
+
+    template <class States, class Transit, class StateId, class History>
+    inline EventResult FireRow(StateId&, History&, const typename Transit::Event&, std::true_type)
+    {
+        return EventResult::Deferred;
+    }
+
+    /// Fires the given flattened row, unless it is a deferral of the event
+    template <class States, class Transit, class StateId, class History>
+    inline EventResult FireRow(StateId& curState, History& history, const typename Transit::Event& ev)
+    {
+        return FireRow<States, Transit>(curState, history, ev, IsDeferral<typename Transit::Declared>());
+    }
+
     ///==============================================================
-    ///= TransitionInfo
+    ///= TransitionRow
     ///==============================================================
-    class TransitionInfo
+    template <std::size_t Index, class Transit>
+    struct TransitionRow
     {
-        public:
-            using TF = void(*)(void);
+        static constexpr std::size_t index = Index;
+        using type = Transit;
+    };
 
-            template<class Transit>
-            static TransitionInfo FromTransition()
-            {
-                TransitionInfo t;
-                t.mPrevStateTypeId = GetTypeId<typename Transit::PrevState>();
-                t.mEventTypeId = GetTypeId<typename Transit::Event>();
-                t.mNextStateTypeId = GetTypeId<typename Transit::NextState>();
+    template <class Seq, class... Transitions>
+    struct MakeTransitionRows;
 
-                using cont = typename Transit::TransFn;
-                t.mTransitionFn = reinterpret_cast<TF>(cont::f);
+    template <std::size_t... Is, class... Transitions>
+    struct MakeTransitionRows<IndexSeq<Is...>, Transitions...>
+    {
+        using type = Packer<TransitionRow<Is, Transitions>...>;
+    };
 
-                return t;
-            }
+    template <class Row>
+    struct IsGuarded : std::integral_constant<bool, !std::is_same<typename Row::type::TransGuard, NoGuard>::value> {};
 
-            TypeId GetPrevStateTypeId() const { return mPrevStateTypeId; };
-            TypeId GetEventTypeId() const { return mEventTypeId; };
-            TypeId GetNextStateTypeId() const { return mNextStateTypeId; };
-            TF GetTransitionFn() const { return mTransitionFn; }
+    // Fires the given row, which is the first candidate of its (state, event)
+    // pair. Unguarded rows fire straight away, guarded ones fall back to the
+    // Later candidates of the pair, all of them resolved at compile time
+    template <class States, class Row, class Later, bool Guarded = IsGuarded<Row>::value>
+    struct CandidateChain
+    {
+        template <class StateId, class History, class Event>
+        static EventResult Fire(StateId& curState, History& history, const Event& ev)
+        {
+            return FireRow<States, typename Row::type>(curState, history, ev);
+        }
+    };
 
-        private:
-            TypeId mPrevStateTypeId;
-            TypeId mEventTypeId;
-            TypeId mNextStateTypeId;
-            TF mTransitionFn;
+    template <class States, class Rows>
+    struct FallbackChain
+    {
+        template <class StateId, class History, class Event>
+        static EventResult Fire(StateId&, History&, const Event&) { return EventResult::Unhandled; }
+    };
+
+    template <class States, class Row, class... Rest>
+    struct FallbackChain<States, Packer<Row, Rest...>> : CandidateChain<States, Row, Packer<Rest...>> {};
+
+    template <class States, class Row, class Later>
+    struct CandidateChain<States, Row, Later, true>
+    {
+        template <class StateId, class History, class Event>
+        static EventResult Fire(StateId& curState, History& history, const Event& ev)
+        {
+            if (InvokeGuard<typename Row::type>(ev))
+                return FireRow<States, typename Row::type>(curState, history, ev);
+            return FallbackChain<States, Later>::Fire(curState, history, ev);
+        }
+    };
+
+    // The later candidates of guarded rows, only computed for those. They are
+    // the rows following the given one in the (state, event) order of the
+    // model's keys, up to the end of its run
+    template <class Model, class Row, bool Guarded = IsGuarded<Row>::value>
+    struct CandidatesAfter
+    {
+        using type = Packer<>;
+    };
+
+    template <class Model, class Row>
+    struct CandidatesAfter<Model, Row, true>
+    {
+        using type = typename PackSelect<typename Model::IndexedRows,
+            typename LaterRowIndices<typename Model::Rows, Row::index>::type>::type;
     };
 
     ///==============================================================
-    ///= TransitionTable
+    ///= RowSwitch
     ///==============================================================
-    template <class... Transitions>
-    class TransitionTable
+    // Compare and branch cascade over the rows triggered by one event. Each
+    // branch stores a constant next state and calls the hooks and the action
+    // directly, so all of them are inlined into the dispatch. The last row is
+    // taken without a compare, as the dispatch policies only ever return rows
+    // of the event being dispatched
+    template <class Model, class EventRows>
+    struct RowSwitch
     {
-        public:
-            TransitionTable() { Add(); }
+        template <class StateId, class History, class Event>
+        static EventResult Fire(std::size_t, StateId&, History&, const Event&) { return EventResult::Unhandled; }
 
-            using const_iterator = std::vector<TransitionInfo>::const_iterator;
-            auto begin() -> const_iterator { return std::begin(mTransitions); }
-            auto end() -> const_iterator { return std::end(mTransitions); }
+        template <class Event>
+        static void Invoke(std::size_t, const Event&) {}
+    };
 
-        private:
-            void Add()
-            {
-                mTransitions.insert(
-                        std::end(mTransitions),
-                        {TransitionInfo::FromTransition<Transitions>()...});
-            }
+    template <class Model, class Row>
+    struct RowSwitch<Model, Packer<Row>>
+    {
+        template <class StateId, class History, class Event>
+        static EventResult Fire(std::size_t, StateId& curState, History& history, const Event& ev)
+        {
+            return CandidateChain<typename Model::States, Row,
+                typename CandidatesAfter<Model, Row>::type>::Fire(curState, history, ev);
+        }
 
-            std::vector<TransitionInfo> mTransitions;
+        /// Runs the hooks and the action of the given row leaving the state alone
+        template <class Event>
+        static void Invoke(std::size_t, const Event& ev) { RunTransition<typename Row::type>(ev); }
     };
 
-    template <class... Transitions>
-    struct ConvertToTransitionTable
+    template <class Model, class Row, class Next, class... Rest>
+    struct RowSwitch<Model, Packer<Row, Next, Rest...>>
     {
-        using type = TransitionTable<Transitions...>;
+        template <class StateId, class History, class Event>
+        static EventResult Fire(std::size_t row, StateId& curState, History& history, const Event& ev)
+        {
+            if (row == Row::index)
+                return RowSwitch<Model, Packer<Row>>::Fire(row, curState, history, ev);
+            return RowSwitch<Model, Packer<Next, Rest...>>::Fire(row, curState, history, ev);
+        }
+
+        template <class Event>
+        static void Invoke(std::size_t row, const Event& ev)
+        {
+            if (row == Row::index)
+                RunTransition<typename Row::type>(ev);
+            else
+                RowSwitch<Model, Packer<Next, Rest...>>::Invoke(row, ev);
+        }
     };
 
-    template <class... Transitions>
-    struct ConvertToTransitionTable<Packer<Transitions...>>
+    ///==============================================================
+    ///= RowTrampolines
+    ///==============================================================
+    // Type erased entry points of one row. Only the row and the types the
+    // firing needs appear in their names, which keeps the symbols of large
+    // tables short
+    template <class States, class StateId, class History, class Row, class Later>
+    struct RowTrampoline
     {
-        using type = typename ConvertToTransitionTable<Transitions...>::type;
+        using Event = typename remove_all<typename Row::type::Event>::type;
+
+        /// Fires the row, trying its later candidates if it is guarded
+        static EventResult Fire(StateId& curState, History& history, const void* ev)
+        {
+            return CandidateChain<States, Row, Later>::Fire(curState, history, *static_cast<const Event*>(ev));
+        }
+
+        /// Runs the hooks and the action of the row leaving the state alone
+        static void Invoke(const void* ev)
+        {
+            RunTransition<typename Row::type>(*static_cast<const Event*>(ev));
+        }
     };
 
+    // The entry points of every row, indexed by the row the dispatch policy
+    // finds. Firing a transition is then one indexed load and one indirect
+    // call, whatever the number of rows of the event, which beats the
+    // cascade of RowSwitch for events with many rows. The event is passed as
+    // a void pointer, which is safe since the dispatch policies only ever
+    // return rows of the event being dispatched
+    template <class Model, class Rows>
+    struct RowTrampolines;
+
+    template <class Model, class... Rows>
+    struct RowTrampolines<Model, Packer<Rows...>>
+    {
+        using FireFn = EventResult (*)(typename Model::StateId&, typename Model::History&, const void*);
+        using InvokeFn = void (*)(const void*);
+
+        static constexpr FireFn fires[sizeof...(Rows)] = {
+            &RowTrampoline<typename Model::States, typename Model::StateId, typename Model::History,
+                Rows, typename CandidatesAfter<Model, Rows>::type>::Fire...
+        };
+
+        static constexpr InvokeFn invokes[sizeof...(Rows)] = {
+            &RowTrampoline<typename Model::States, typename Model::StateId, typename Model::History, Rows, Packer<>>::Invoke...
+        };
+    };
+
+    template <class Model, class... Rows>
+    constexpr typename RowTrampolines<Model, Packer<Rows...>>::FireFn RowTrampolines<Model, Packer<Rows...>>::fires[];
+
+    template <class Model, class... Rows>
+    constexpr typename RowTrampolines<Model, Packer<Rows...>>::InvokeFn RowTrampolines<Model, Packer<Rows...>>::invokes[];
+
+    ///==============================================================
+    ///= RowTraits
+    ///==============================================================
+    // What the rows triggered by one event need at run time, which lets
+    // batch dispatch skip the per machine work they do not need
+    template <class Rows>
+    struct RowTraits
+    {
+        /// Whether any of the rows has an action or a hook to run
+        static constexpr bool hasActions = false;
+
+        /// Whether any of the rows has a guard
+        static constexpr bool hasGuards = false;
+    };
+
+    template <class Row, class... Rest>
+    struct RowTraits<Packer<Row, Rest...>>
+    {
+        static constexpr bool hasGuards = IsGuarded<Row>::value || RowTraits<Packer<Rest...>>::hasGuards;
+
+        static constexpr bool hasActions =
+            !std::is_same<typename Row::type::TransFn, NoAction>::value ||
+            PackSize<typename Row::type::Exits>::value != 0 ||
+            PackSize<typename Row::type::Entries>::value != 0 ||
+            RowTraits<Packer<Rest...>>::hasActions;
+    };
+
+    ///==============================================================
+    ///= MachineModel
+    ///==============================================================
+    // Everything a state machine type knows at compile time. It is shared
+    // by all instances of that type, which only carry their current state.
+    // Composite states are flattened away, so the model only ever deals with
+    // leaf states and the transitions they fire, inherited ones included
+    template <class InitState, class TransitionsPack, class DispatchPolicy = DenseDispatch,
+              class FlatTransitions = typename Hierarchy<InitState, TransitionsPack>::FlatTransitions>
+    struct MachineModel;
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy, class... Transitions>
+    struct MachineModel<InitState, TransitionsPack, DispatchPolicy, Packer<Transitions...>>
+    {
+        static_assert(sizeof...(Transitions) > 0, "The transition table must not be empty");
+
+        /// Every leaf state of the machine with the one entered at start at index 0
+        using States = typename Hierarchy<InitState, TransitionsPack>::States;
+
+        /// The states enclosing other states, which are never current on their own
+        using Composites = typename Hierarchy<InitState, TransitionsPack>::Composites;
+
+        /// Every event that triggers at least one transition
+        using Events = typename TypeSet<typename Transitions::Event...>::type;
+
+        static constexpr std::size_t StateCount = PackSize<States>::value;
+        static constexpr std::size_t EventCount = PackSize<Events>::value;
+        static constexpr std::size_t TransitionCount = sizeof...(Transitions);
+
+        /// The narrowest unsigned integer able to hold any state index
+        using StateId = typename SmallestUInt<StateCount - 1>::type;
+
+        /// The history pseudo-states targeted by some transition
+        using HistoryKeys = typename Hierarchy<InitState, TransitionsPack>::HistoryKeys;
+
+        /// Per instance storage of the last active members of composites with history
+        using History = HistoryStorage<States, HistoryKeys>;
+
+        static constexpr bool HasHistory = PackSize<HistoryKeys>::value != 0;
+
+        /// The events deferred by some state
+        using DeferredEvents = typename Hierarchy<InitState, TransitionsPack>::DeferredEvents;
+
+        static constexpr bool HasDeferrals = PackSize<DeferredEvents>::value != 0;
+
+        /// Per instance queue of deferred events holding up to Capacity of them,
+        /// empty for machines that defer nothing
+        template <class Machine, std::size_t Capacity>
+        using DeferredEventQueue = typename std::conditional<HasDeferrals,
+            DeferredQueue<MachineModel, Machine, Capacity>, NoDeferredQueue>::type;
+
+        /// Dense compile time index of the given state in [0, StateCount)
+        template <class State>
+        static constexpr std::size_t StateIndex() { return TypeIndex<State, States>::value; }
+
+        /// Dense compile time index of the given event in [0, EventCount)
+        template <class Event>
+        static constexpr std::size_t EventIndex() { return TypeIndex<Event, Events>::value; }
+
+        /// Whether the given leaf state index is the given state or lies inside it
+        template <class State>
+        static bool InState(StateId state)
+        {
+            return InState<typename remove_all<State>::type>(state, PackContains<typename remove_all<State>::type, States>());
+        }
+
+        /// The transition table translated into (state, event) keys and a dense jump
+        /// table, the latter only instantiated if the dispatch policy looks into it
+        using Rows = JumpTableRows<States, Events, Transitions...>;
+        using Cells = JumpTableCells<Rows, typename MakeIndexSeq<StateCount * EventCount>::type>;
+
+        /// The transitions tagged with their position in the table
+        using IndexedRows = typename MakeTransitionRows<
+            typename MakeIndexSeq<TransitionCount>::type, Transitions...
+        >::type;
+
+        /// The indexed rows triggered by the given event, picked out of the rows
+        /// bucketed by event once for the whole table
+        template <class Event>
+        using EventRows = typename PackSelect<IndexedRows,
+            typename EventRowIndices<Rows, EventIndex<Event>()>::type>::type;
+
+        /// The compile time traits of the rows triggered by the given event
+        template <class Event>
+        using Actions = RowTraits<EventRows<Event>>;
+
+        /// The type erased entry points of the rows, indexed like the dispatch tables
+        using Trampolines = RowTrampolines<MachineModel, IndexedRows>;
+
+        /// Events with up to this many rows fire through the inlined cascade of RowSwitch,
+        /// the others through one indirect call into the Trampolines
+        static constexpr std::size_t InlineRowLimit = 8;
+
+        /// Whether the given event fires through the Trampolines
+        template <class Event>
+        using FiresIndirectly = std::integral_constant<bool, (PackSize<EventRows<Event>>::value > InlineRowLimit)>;
+
+        /// The per-state next state lookup table of the given event
+        template <class Event>
+        using NextStates = NextStateColumn<Rows, StateId, EventIndex<Event>(),
+            typename MakeIndexSeq<(StateCount < 16 ? 16 : StateCount)>::type>;
+
+        /// Returns the index of the transition that fires for the given state and event,
+        /// or TransitionCount if there is none
+        template <class Event>
+        static std::size_t FindTransition(StateId state) { return DispatchPolicy::template Find<MachineModel, Event>(state); }
+
+        /// Fires the transition of the given state for the given event, if any.
+        /// Events the state defers are left to the caller to queue
+        template <class Event>
+        static EventResult Dispatch(StateId& curState, History& history, const Event& ev)
+        {
+            // Events that appear nowhere in the table are dropped at compile time
+            return Dispatch(curState, history, ev, PackContains<Event, Events>());
+        }
+
+        /// Same as above for machines without history or deferrals, which need
+        /// no storage besides their state
+        template <class Event>
+        static void Dispatch(StateId& curState, const Event& ev)
+        {
+            static_assert(!HasHistory, "Machines with history pseudo-states must be given their history storage");
+            static_assert(!HasDeferrals, "Machines with deferrals must be given a queue for the deferred events");
+            History none;
+            Dispatch(curState, none, ev);
+        }
+
+        /// Runs the hooks and the action of the given row of the event, leaving the state alone
+        template <class Event>
+        static void Invoke(std::size_t row, const Event& ev) { Invoke(row, ev, FiresIndirectly<Event>()); }
+
+        private:
+            template <class Event>
+            static EventResult Dispatch(StateId& curState, History& history, const Event& ev, std::true_type)
+            {
+                const std::size_t row = FindTransition<Event>(curState);
+                if (row == TransitionCount)
+                    return EventResult::Unhandled;
+                return Fire(row, curState, history, ev, FiresIndirectly<Event>());
+            }
+
+            template <class Event>
+            static EventResult Fire(std::size_t row, StateId& curState, History& history, const Event& ev, std::false_type)
+            {
+                return RowSwitch<MachineModel, EventRows<Event>>::Fire(row, curState, history, ev);
+            }
+
+            template <class Event>
+            static EventResult Fire(std::size_t row, StateId& curState, History& history, const Event& ev, std::true_type)
+            {
+                return Trampolines::fires[row](curState, history, &ev);
+            }
+
+            template <class Event>
+            static void Invoke(std::size_t row, const Event& ev, std::false_type) { RowSwitch<MachineModel, EventRows<Event>>::Invoke(row, ev); }
+
+            template <class Event>
+            static void Invoke(std::size_t row, const Event& ev, std::true_type) { Trampolines::invokes[row](&ev); }
+
+            template <class Event>
+            static EventResult Dispatch(StateId&, History&, const Event&, std::false_type) { return EventResult::Unhandled; }
+
+            template <class State>
+            static bool InState(StateId state, std::true_type) { return state == StateIndex<State>(); }
+
+            template <class State>
+            static bool InState(StateId state, std::false_type)
+            {
+                static_assert(PackContains<State, Composites>::value, "The given type is not a state of the machine");
+                return InStateFlags<State, States>::values[state];
+            }
+    };
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy, class... Transitions>
+    constexpr std::size_t MachineModel<InitState, TransitionsPack, DispatchPolicy, Packer<Transitions...>>::StateCount;
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy, class... Transitions>
+    constexpr std::size_t MachineModel<InitState, TransitionsPack, DispatchPolicy, Packer<Transitions...>>::EventCount;
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy, class... Transitions>
+    constexpr std::size_t MachineModel<InitState, TransitionsPack, DispatchPolicy, Packer<Transitions...>>::TransitionCount;
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy, class... Transitions>
+    constexpr std::size_t MachineModel<InitState, TransitionsPack, DispatchPolicy, Packer<Transitions...>>::InlineRowLimit;
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy, class... Transitions>
+    constexpr bool MachineModel<InitState, TransitionsPack, DispatchPolicy, Packer<Transitions...>>::HasHistory;
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy, class... Transitions>
+    constexpr bool MachineModel<InitState, TransitionsPack, DispatchPolicy, Packer<Transitions...>>::HasDeferrals;
+
     ///==============================================================
     ///= StateMachine
     ///==============================================================
-    template <class InitState, class TransitionsPack>
+    // An instance holds nothing but its current state and, for machines
+    // with history pseudo-states, the compact history of their composites.
+    // Machines with deferrals also hold a queue of up to DeferCapacity
+    // deferred events. The transition table lives once per machine type in
+    // static read-only storage. The DispatchPolicy selects how transitions
+    // are looked up, the ObserverPolicy what is reported of the events
+    // dispatched (see NullObserver) and the UnhandledPolicy what becomes of
+    // the events no transition accepts (see IgnoreUnhandled)
+    template <class InitState, class TransitionsPack, class DispatchPolicy = DenseDispatch, std::size_t DeferCapacity = 16,
+              template <class> class ObserverPolicy = NullObserver, template <class> class UnhandledPolicy = IgnoreUnhandled>
     class StateMachine
+        : private MachineModel<InitState, TransitionsPack, DispatchPolicy>::History
+        , private MachineModel<InitState, TransitionsPack, DispatchPolicy>::template DeferredEventQueue<
+            StateMachine<InitState, TransitionsPack, DispatchPolicy, DeferCapacity, ObserverPolicy, UnhandledPolicy>, DeferCapacity>
+        , private ObserverPolicy<MachineModel<InitState, TransitionsPack, DispatchPolicy>>
+        , private UnhandledPolicy<MachineModel<InitState, TransitionsPack, DispatchPolicy>>
     {
         public:
-            /// Starts the operation of the State Machine
+            /// The compile time description shared by all instances of this type
+            using Model = MachineModel<InitState, TransitionsPack, DispatchPolicy>;
+
+            /// The deduplicated leaf states of the machine, the initial one being the first
+            using States = typename Model::States;
+
+            /// The deduplicated events that trigger at least one transition
+            using Events = typename Model::Events;
+
+            static constexpr std::size_t StateCount = Model::StateCount;
+            static constexpr std::size_t EventCount = Model::EventCount;
+
+            /// The narrowest unsigned integer able to hold the current state
+            using StateId = typename Model::StateId;
+
+            /// The observer notified of the events dispatched by this machine
+            using Observer = ObserverPolicy<Model>;
+
+            /// The policy applied to the events no transition accepts
+            using Unhandled = UnhandledPolicy<Model>;
+
+            /// Dense compile time index of the given state in [0, StateCount)
+            template <class State>
+            static constexpr std::size_t StateIndex() { return Model::template StateIndex<State>(); }
+
+            /// Dense compile time index of the given event in [0, EventCount)
+            template <class Event>
+            static constexpr std::size_t EventIndex() { return Model::template EventIndex<Event>(); }
+
+            /// Constructs the machine in its initial state
+            constexpr StateMachine() noexcept : mCurState(0) {}
+
+            /// Starts the operation of the State Machine, entering the initial state
+            /// and discarding the events deferred so far
             void Start();
 
-            /// Stops the operation of the State Machine
+            /// Stops the operation of the State Machine, leaving the current state
             void Stop();
 
+            /// Dispatches the event, or queues it if the current state defers it.
+            /// Whenever the state changes, the queued events are dispatched again.
+            /// Self transitions leave the state as it was, so even though they run
+            /// the exit and entry hooks they do not replay the queue.
+            /// Returns the outcome for this event only, an unhandled one being known
+            /// from the transition lookup alone. Deferred events the full queue cannot
+            /// take are dropped, reported to the observer and the unhandled policy
+            /// and returned as unhandled
             template <class Event>
-            void ProcessEvent(const Event& ev);
+            EventResult ProcessEvent(const Event& ev);
+
+            /// Checks whether the given state is the currently active one,
+            /// or encloses it for composite states
+            template <class State>
+            bool IsInState() const noexcept { return Model::template InState<State>(mCurState); }
+
+            /// Retrieves the dense index of the currently active state
+            StateId GetState() const noexcept { return mCurState; }
+
+            /// Retrieves the number of events waiting in the deferred queue
+            std::size_t GetDeferredCount() const noexcept { return Deferred::Size(); }
+
+            /// Accesses the observer of this machine
+            Observer& GetObserver() noexcept { return *this; }
+            const Observer& GetObserver() const noexcept { return *this; }
+
+            /// Accesses the unhandled event policy of this machine
+            Unhandled& GetUnhandledPolicy() noexcept { return *this; }
+            const Unhandled& GetUnhandledPolicy() const noexcept { return *this; }
+
+            /// Retrieves the current state index in a caller chosen unsigned type,
+            /// which is checked at compile time to be wide enough for every state
+            template <class UInt>
+            UInt GetStateAs() const noexcept;
+
+            /// Restores a state index previously obtained through GetState,
+            /// which leaves the history of composite states alone
+            void RestoreState(StateId state) noexcept;
 
         private:
-            /// Stores the currently active transition id
-            TypeId mCurStateTypeId;
+            using History = typename Model::History;
+            using Deferred = typename Model::template DeferredEventQueue<StateMachine, DeferCapacity>;
+
+            friend Deferred;
+
+            /// Dispatches the event and reports the outcome to the observer, to the unhandled
+            /// policy and to the process_event probe. Deferred events are queued if enqueue is
+            /// set, while the queue replays its own events with it cleared
+            template <class Event>
+            EventResult Dispatch(const Event& ev, bool enqueue);
 
-            /// The transition table translated into type id's
-            using TT = typename ConvertToTransitionTable<TransitionsPack>::type;
-            TT mTransitionTbl;
+            template <class Event>
+            EventResult Dispatch(const Event& ev, bool enqueue, std::true_type);
+
+            /// Events that appear nowhere in the table are only reported as unhandled
+            template <class Event>
+            EventResult Dispatch(const Event&, bool, std::false_type);
+
+            /// Queues an event named in the deferrals of the machine. Returns false if the queue is full
+            template <class Event>
+            bool Defer(const Event& ev, std::true_type) { return Deferred::Push(ev); }
+
+            /// Other events are never deferred, which keeps them out of the queue's slot layout
+            template <class Event>
+            bool Defer(const Event&, std::false_type) noexcept { return false; }
+
+            /// Stores the index of the currently active state
+            StateId mCurState;
     };
 
-    template <class InitState, class TransitionsPack>
-    inline void StateMachine<InitState, TransitionsPack>::Start()
+    template <class InitState, class TransitionsPack, class DispatchPolicy, std::size_t DeferCapacity,
+              template <class> class ObserverPolicy, template <class> class UnhandledPolicy>
+    constexpr std::size_t StateMachine<InitState, TransitionsPack, DispatchPolicy, DeferCapacity, ObserverPolicy, UnhandledPolicy>::StateCount;
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy, std::size_t DeferCapacity,
+              template <class> class ObserverPolicy, template <class> class UnhandledPolicy>
+    constexpr std::size_t StateMachine<InitState, TransitionsPack, DispatchPolicy, DeferCapacity, ObserverPolicy, UnhandledPolicy>::EventCount;
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy, std::size_t DeferCapacity,
+              template <class> class ObserverPolicy, template <class> class UnhandledPolicy>
+    inline void StateMachine<InitState, TransitionsPack, DispatchPolicy, DeferCapacity, ObserverPolicy, UnhandledPolicy>::Start()
     {
-        mCurStateTypeId = GetTypeId<InitState>();
+        mCurState = StateIndex<typename InitialLeaf<InitState>::type>();
+        static_cast<History&>(*this) = History();
+        Deferred::Clear();
+        HookCalls<StartEntries<typename InitialLeaf<InitState>::type>>::Enter();
+        Observer::OnStateEntered(mCurState);
+        GEARLESS_PROBE2(start, static_cast<const void*>(this), static_cast<unsigned>(mCurState));
     }
 
-    template <class InitState, class TransitionsPack>
-    inline void StateMachine<InitState, TransitionsPack>::Stop()
+    template <class InitState, class TransitionsPack, class DispatchPolicy, std::size_t DeferCapacity,
+              template <class> class ObserverPolicy, template <class> class UnhandledPolicy>
+    inline void StateMachine<InitState, TransitionsPack, DispatchPolicy, DeferCapacity, ObserverPolicy, UnhandledPolicy>::Stop()
     {
+        StopCascade<States>::Exit(mCurState);
+        Observer::OnStateLeft(mCurState);
+        GEARLESS_PROBE2(stop, static_cast<const void*>(this), static_cast<unsigned>(mCurState));
+    }
 
+    template <class InitState, class TransitionsPack, class DispatchPolicy, std::size_t DeferCapacity,
+              template <class> class ObserverPolicy, template <class> class UnhandledPolicy>
+    template <class Event>
+    inline EventResult StateMachine<InitState, TransitionsPack, DispatchPolicy, DeferCapacity, ObserverPolicy, UnhandledPolicy>::ProcessEvent(const Event& ev)
+    {
+        const StateId prev = mCurState;
+        const EventResult result = Dispatch(ev, true);
+        if (mCurState != prev)
+            Deferred::Replay(*this);
+        return result;
     }
 
-    template <class InitState, class TransitionsPack>
+    template <class InitState, class TransitionsPack, class DispatchPolicy, std::size_t DeferCapacity,
+              template <class> class ObserverPolicy, template <class> class UnhandledPolicy>
     template <class Event>
-    inline void StateMachine<InitState, TransitionsPack>::ProcessEvent(const Event& ev)
+    inline EventResult StateMachine<InitState, TransitionsPack, DispatchPolicy, DeferCapacity, ObserverPolicy, UnhandledPolicy>::Dispatch(const Event& ev, bool enqueue)
     {
-        for (const TransitionInfo& ti : mTransitionTbl)
+        const StateId prev = mCurState;
+        const EventResult result = Dispatch(ev, enqueue, PackContains<Event, Events>());
+        if (result == EventResult::Unhandled)
+            Unhandled::OnUnhandledEvent(prev, ev);
+        GEARLESS_PROBE5(process_event, static_cast<const void*>(this), static_cast<unsigned>(prev),
+                        static_cast<unsigned>(PackIndexOf<Event, Events>::value), static_cast<unsigned>(mCurState),
+                        static_cast<unsigned>(result));
+        return result;
+    }
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy, std::size_t DeferCapacity,
+              template <class> class ObserverPolicy, template <class> class UnhandledPolicy>
+    template <class Event>
+    inline EventResult StateMachine<InitState, TransitionsPack, DispatchPolicy, DeferCapacity, ObserverPolicy, UnhandledPolicy>::Dispatch(const Event& ev, bool enqueue, std::true_type)
+    {
+        const StateId prev = mCurState;
+        Observer::template OnDispatch<Event>(prev);
+        EventResult result = Model::Dispatch(mCurState, static_cast<History&>(*this), ev);
+        // A deferred event the full queue cannot take is dropped, which is settled
+        // before anything is reported so that it is only ever reported as unhandled
+        if (result == EventResult::Deferred && enqueue && !Defer(ev, PackContains<Event, typename Model::DeferredEvents>()))
+            result = EventResult::Unhandled;
+        if (result == EventResult::Handled)
         {
-            if (ti.GetPrevStateTypeId() == mCurStateTypeId &&
-                ti.GetEventTypeId() == GetTypeId<Event>())
-            {
-                mCurStateTypeId = ti.GetNextStateTypeId();
-                reinterpret_cast<void(*)(const Event&)>(ti.GetTransitionFn())(ev);
-                break;
-            }
+            Observer::OnStateLeft(prev);
+            Observer::template OnTransition<Event>(prev, mCurState);
+            Observer::OnStateEntered(mCurState);
         }
+        else if (result == EventResult::Unhandled)
+            Observer::template OnUnhandled<Event>(prev);
+        else
+            Observer::template OnDeferred<Event>(prev);
+        return result;
+    }
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy, std::size_t DeferCapacity,
+              template <class> class ObserverPolicy, template <class> class UnhandledPolicy>
+    template <class Event>
+    inline EventResult StateMachine<InitState, TransitionsPack, DispatchPolicy, DeferCapacity, ObserverPolicy, UnhandledPolicy>::Dispatch(const Event&, bool, std::false_type)
+    {
+        Observer::template OnUnhandled<Event>(mCurState);
+        return EventResult::Unhandled;
+    }
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy, std::size_t DeferCapacity,
+              template <class> class ObserverPolicy, template <class> class UnhandledPolicy>
+    template <class UInt>
+    inline UInt StateMachine<InitState, TransitionsPack, DispatchPolicy, DeferCapacity, ObserverPolicy, UnhandledPolicy>::GetStateAs() const noexcept
+    {
+        static_assert(std::is_unsigned<UInt>::value, "State indices must be read out into unsigned types");
+        static_assert(StateCount - 1 <= std::numeric_limits<UInt>::max(), "The given type is too narrow for the state count");
+        return static_cast<UInt>(mCurState);
+    }
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy, std::size_t DeferCapacity,
+              template <class> class ObserverPolicy, template <class> class UnhandledPolicy>
+    inline void StateMachine<InitState, TransitionsPack, DispatchPolicy, DeferCapacity, ObserverPolicy, UnhandledPolicy>::RestoreState(StateId state) noexcept
+    {
+        assert(state < StateCount);
+        mCurState = state;
     }
 }
 
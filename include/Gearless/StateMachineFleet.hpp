@@ -0,0 +1,267 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#ifndef _STATE_MACHINE_FLEET_HPP_
+#define _STATE_MACHINE_FLEET_HPP_
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include <Gearless/StateMachine.hpp>
+#include <Gearless/BatchDispatch.hpp>
+#include <Gearless/EventBatch.hpp>
+
+namespace Gearless
+{
+    ///==============================================================
+    ///= CountTrailingZeros
+    ///==============================================================
+    inline unsigned CountTrailingZeros(std::uint64_t word)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        return static_cast<unsigned>(__builtin_ctzll(word));
+#else
+        unsigned n = 0;
+        while ((word & 1) == 0) { word >>= 1; ++n; }
+        return n;
+#endif
+    }
+
+    ///==============================================================
+    ///= StateMachineFleet
+    ///==============================================================
+    // Structure of arrays container for large numbers of machines of the
+    // same type. It stores nothing but a contiguous array of compact state
+    // indices, all of them dispatched through the one shared MachineModel
+    template <class InitState, class TransitionsPack, class DispatchPolicy = DenseDispatch>
+    class StateMachineFleet
+    {
+        public:
+            /// The compile time description shared by all machines of the fleet
+            using Model = MachineModel<InitState, TransitionsPack, DispatchPolicy>;
+            static_assert(!Model::HasHistory, "Fleets only store state indices and do not support history pseudo-states");
+            static_assert(!Model::HasDeferrals, "Fleets only store state indices and do not support deferrals");
+
+            /// The compact state index type stored per machine
+            using StateId = typename Model::StateId;
+
+            /// Identifies a machine of the fleet by its position
+            using Handle = std::size_t;
+
+            /// Constructs a fleet of count machines in their initial state
+            explicit StateMachineFleet(std::size_t count = 0);
+
+            /// Appends a machine in its initial state and returns its handle
+            Handle Add();
+
+            /// Grows or shrinks the fleet, new machines start in their initial state
+            void Resize(std::size_t count);
+
+            /// Preallocates storage for the given number of machines
+            void Reserve(std::size_t count);
+
+            /// Retrieves the number of machines in the fleet
+            std::size_t Size() const noexcept { return mStates.size(); }
+
+            /// Resets the given machine to its initial state, running its entry hooks
+            void Start(Handle h);
+
+            /// Dispatches the event to a single machine
+            template <class Event>
+            void ProcessEvent(Handle h, const Event& ev);
+
+            /// Dispatches the event to every machine in [first, last) as a batch: the
+            /// next states are gathered from the event's lookup column with vector
+            /// instructions, then the actions run for the machines whose transition fired.
+            /// Events with guarded transitions are dispatched machine by machine instead
+            template <class Event>
+            void ProcessEvent(const Event& ev, Handle first, Handle last);
+
+            /// Dispatches the event to every machine whose bit is set in the mask,
+            /// where bit (i % 64) of mask[i / 64] selects machine i. The mask holds
+            /// (Size() + 63) / 64 words, the bits past the last machine are ignored
+            template <class Event>
+            void ProcessEvent(const Event& ev, const std::uint64_t* mask);
+
+            /// Dispatches the event to every machine of the fleet
+            template <class Event>
+            void ProcessEvent(const Event& ev);
+
+            /// Dispatches a batch of mixed events, grouped by event type while
+            /// preserving the order of the events posted to each machine
+            void ProcessEvents(EventBatch<Model>& batch);
+
+            /// Checks whether the given machine is in the given state
+            template <class State>
+            bool IsInState(Handle h) const { return Model::template InState<State>(mStates[h]); }
+
+            /// Retrieves the dense state index of the given machine
+            StateId GetState(Handle h) const { return mStates[h]; }
+
+            /// Direct access to the contiguous state indices of all machines
+            const StateId* Data() const noexcept { return mStates.data(); }
+
+        private:
+            /// Number of machines whose previous states are kept on the stack
+            /// while the actions of a batch run
+            static constexpr std::size_t BatchChunk = 256;
+
+            template <class Event>
+            void ProcessBatch(const Event& ev, Handle first, Handle last, std::true_type);
+
+            template <class Event>
+            void ProcessBatch(const Event&, Handle, Handle, std::false_type) {}
+
+            /// The current state index of every machine
+            std::vector<StateId> mStates;
+    };
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy>
+    inline StateMachineFleet<InitState, TransitionsPack, DispatchPolicy>::StateMachineFleet(std::size_t count)
+        : mStates(count, static_cast<StateId>(Model::template StateIndex<typename InitialLeaf<InitState>::type>()))
+    {
+    }
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy>
+    inline auto StateMachineFleet<InitState, TransitionsPack, DispatchPolicy>::Add() -> Handle
+    {
+        mStates.push_back(static_cast<StateId>(Model::template StateIndex<typename InitialLeaf<InitState>::type>()));
+        return mStates.size() - 1;
+    }
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy>
+    inline void StateMachineFleet<InitState, TransitionsPack, DispatchPolicy>::Resize(std::size_t count)
+    {
+        mStates.resize(count, static_cast<StateId>(Model::template StateIndex<typename InitialLeaf<InitState>::type>()));
+    }
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy>
+    inline void StateMachineFleet<InitState, TransitionsPack, DispatchPolicy>::Reserve(std::size_t count)
+    {
+        mStates.reserve(count);
+    }
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy>
+    inline void StateMachineFleet<InitState, TransitionsPack, DispatchPolicy>::Start(Handle h)
+    {
+        mStates[h] = static_cast<StateId>(Model::template StateIndex<typename InitialLeaf<InitState>::type>());
+        HookCalls<StartEntries<typename InitialLeaf<InitState>::type>>::Enter();
+    }
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy>
+    template <class Event>
+    inline void StateMachineFleet<InitState, TransitionsPack, DispatchPolicy>::ProcessEvent(Handle h, const Event& ev)
+    {
+        assert(h < mStates.size() && "Event dispatched to a handle outside of the fleet");
+        Model::Dispatch(mStates[h], ev);
+    }
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy>
+    template <class Event>
+    inline void StateMachineFleet<InitState, TransitionsPack, DispatchPolicy>::ProcessEvent(const Event& ev, Handle first, Handle last)
+    {
+        assert(first <= last && last <= mStates.size() && "Event dispatched to a range outside of the fleet");
+        // Events that appear nowhere in the table are dropped at compile time
+        ProcessBatch(ev, first, last, PackContains<Event, typename Model::Events>());
+    }
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy>
+    inline void StateMachineFleet<InitState, TransitionsPack, DispatchPolicy>::ProcessEvents(EventBatch<Model>& batch)
+    {
+        batch.Apply(mStates.data(), mStates.size());
+    }
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy>
+    template <class Event>
+    inline void StateMachineFleet<InitState, TransitionsPack, DispatchPolicy>::ProcessBatch(const Event& ev, Handle first, Handle last, std::true_type)
+    {
+        using Column = typename Model::template NextStates<Event>;
+        using Actions = typename Model::template Actions<Event>;
+        StateId* states = mStates.data();
+
+        // Guards make the next states depend on the event payload, so every machine is dispatched on its own
+        if (Actions::hasGuards)
+        {
+            for (Handle h = first; h < last; ++h)
+                Model::Dispatch(states[h], ev);
+            return;
+        }
+
+        // Without actions to run the whole range is a single table gather
+        if (!Actions::hasActions)
+        {
+            GatherNextStates<Column>(states + first, last - first, Model::StateCount);
+            return;
+        }
+
+        StateId prev[BatchChunk];
+        for (Handle h = first; h < last; h += BatchChunk)
+        {
+            const std::size_t n = last - h < BatchChunk ? last - h : BatchChunk;
+            std::copy(states + h, states + h + n, prev);
+            GatherNextStates<Column>(states + h, n, Model::StateCount);
+            for (std::size_t i = 0; i < n; ++i)
+            {
+                const std::size_t row = Model::template FindTransition<Event>(prev[i]);
+                if (row != Model::TransitionCount)
+                    Model::Invoke(row, ev);
+            }
+        }
+    }
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy>
+    template <class Event>
+    inline void StateMachineFleet<InitState, TransitionsPack, DispatchPolicy>::ProcessEvent(const Event& ev, const std::uint64_t* mask)
+    {
+        StateId* states = mStates.data();
+        const std::size_t wordCount = (mStates.size() + 63) / 64;
+        const std::size_t tail = mStates.size() % 64;
+        for (std::size_t w = 0; w < wordCount; ++w)
+        {
+            std::uint64_t bits = mask[w];
+            if (w == wordCount - 1 && tail != 0)
+                bits &= (std::uint64_t(1) << tail) - 1;
+
+            // Visit the set bits only, so sparse masks skip whole words at once
+            for (; bits != 0; bits &= bits - 1)
+                Model::Dispatch(states[w * 64 + CountTrailingZeros(bits)], ev);
+        }
+    }
+
+    template <class InitState, class TransitionsPack, class DispatchPolicy>
+    template <class Event>
+    inline void StateMachineFleet<InitState, TransitionsPack, DispatchPolicy>::ProcessEvent(const Event& ev)
+    {
+        ProcessEvent(ev, 0, mStates.size());
+    }
+}
+
+#endif // ! _STATE_MACHINE_FLEET_HPP_
@@ -0,0 +1,300 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#ifndef _TRACE_RING_HPP_
+#define _TRACE_RING_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <Gearless/Clock.hpp>
+#include <Gearless/Dispatch.hpp>
+#include <Gearless/TypeList.hpp>
+
+namespace Gearless
+{
+    ///==============================================================
+    ///= TraceRecord
+    ///==============================================================
+    // One dispatched event, as decoded from a trace ring. The state indices
+    // and the event index are the dense ones of the machine's model
+    struct TraceRecord
+    {
+        /// Event index of the events that appear nowhere in the transition table
+        static constexpr std::uint16_t UnknownEvent = 0xFFFF;
+
+        std::uint64_t timestamp;
+        std::uint32_t machine;
+        std::uint32_t state;
+        std::uint32_t next;
+        std::uint16_t event;
+        EventResult result;
+    };
+
+    ///==============================================================
+    ///= TraceRing
+    ///==============================================================
+    // Fixed capacity ring of the last events dispatched on one thread, each
+    // packed into three 64 bit words. Every thread that traces claims a ring
+    // of its own on first use and writes it without any synchronization with
+    // other writers. Readers may snapshot any ring at any time: the words
+    // are relaxed atomics, and the records a reader might have seen being
+    // overwritten are discarded by checking the write count again after the
+    // copy, as with a seqlock. Rings are never freed. When a thread exits its
+    // ring keeps its records for post-mortem inspection until another thread
+    // claims it
+    class TraceRing
+    {
+        public:
+            /// Number of records kept per ring
+            static constexpr std::size_t Capacity = 4096;
+
+            /// Number of words per encoded record
+            static constexpr std::size_t RecordWords = 3;
+
+            TraceRing(const TraceRing&) = delete;
+            TraceRing& operator=(const TraceRing&) = delete;
+
+            /// The ring of the calling thread, claimed on first use
+            static TraceRing& ForThisThread();
+
+            /// Calls fn(ring) for every ring ever claimed, those of exited threads
+            /// included. Takes no lock and allocates nothing
+            template <class Fn>
+            static void ForEach(Fn fn);
+
+            /// Appends a record, overwriting the oldest one once the ring is full.
+            /// Owner thread only
+            void Write(std::uint64_t timestamp, std::uint32_t machine, std::uint32_t state,
+                       std::uint16_t event, std::uint32_t next, EventResult result) noexcept;
+
+            /// Number of records written since the ring was created
+            std::uint64_t Written() const noexcept { return mHead.load(std::memory_order_acquire); }
+
+            /// Copies the encoded words of up to max of the latest records into out,
+            /// oldest first, and returns the number of records copied. Takes no lock
+            /// and allocates nothing, so it may be called from a crash handler
+            std::size_t Snapshot(std::uint64_t* out, std::size_t max) const noexcept;
+
+            /// Same as above for every record available, decoded
+            std::vector<TraceRecord> Snapshot() const;
+
+            /// Decodes the given encoded words of one record
+            static TraceRecord Decode(const std::uint64_t* words) noexcept;
+
+        private:
+            TraceRing() noexcept;
+
+            /// Claims a ring no live thread owns, or creates one
+            static TraceRing* Claim();
+
+            static std::atomic<TraceRing*>& Registry() noexcept
+            {
+                // Constant initialized, like the type id counter
+                static std::atomic<TraceRing*> head(nullptr);
+                return head;
+            }
+
+            static constexpr std::size_t Mask = Capacity - 1;
+
+            std::atomic<std::uint64_t> mWords[Capacity * RecordWords];
+            std::atomic<std::uint64_t> mHead;
+            std::atomic<bool> mOwned;
+            TraceRing* mNext;
+    };
+
+    inline TraceRing::TraceRing() noexcept : mHead(0), mOwned(true), mNext(nullptr)
+    {
+        for (std::size_t i = 0; i < Capacity * RecordWords; ++i)
+            mWords[i].store(0, std::memory_order_relaxed);
+    }
+
+    inline TraceRing& TraceRing::ForThisThread()
+    {
+        struct Owner
+        {
+            TraceRing* ring;
+            Owner() : ring(Claim()) {}
+            ~Owner() { ring->mOwned.store(false, std::memory_order_release); }
+        };
+        static thread_local Owner owner;
+        return *owner.ring;
+    }
+
+    inline TraceRing* TraceRing::Claim()
+    {
+        std::atomic<TraceRing*>& registry = Registry();
+        for (TraceRing* ring = registry.load(std::memory_order_acquire); ring; ring = ring->mNext)
+        {
+            bool owned = false;
+            if (!ring->mOwned.load(std::memory_order_relaxed) &&
+                ring->mOwned.compare_exchange_strong(owned, true, std::memory_order_acquire))
+                return ring;
+        }
+
+        TraceRing* ring = new TraceRing();
+        ring->mNext = registry.load(std::memory_order_relaxed);
+        while (!registry.compare_exchange_weak(ring->mNext, ring, std::memory_order_release, std::memory_order_relaxed))
+            ;
+        return ring;
+    }
+
+    template <class Fn>
+    inline void TraceRing::ForEach(Fn fn)
+    {
+        for (TraceRing* ring = Registry().load(std::memory_order_acquire); ring; ring = ring->mNext)
+            fn(static_cast<const TraceRing&>(*ring));
+    }
+
+    inline void TraceRing::Write(std::uint64_t timestamp, std::uint32_t machine, std::uint32_t state,
+                                 std::uint16_t event, std::uint32_t next, EventResult result) noexcept
+    {
+        const std::uint64_t pos = mHead.load(std::memory_order_relaxed);
+        std::atomic<std::uint64_t>* words = &mWords[(pos & Mask) * RecordWords];
+        // Keep the count published by the previous write ahead of these stores,
+        // so that readers seeing any of them also see that the slot is reused
+        std::atomic_thread_fence(std::memory_order_release);
+        words[0].store(timestamp, std::memory_order_relaxed);
+        words[1].store(machine | static_cast<std::uint64_t>(event) << 32 |
+                       static_cast<std::uint64_t>(result) << 48, std::memory_order_relaxed);
+        words[2].store(state | static_cast<std::uint64_t>(next) << 32, std::memory_order_relaxed);
+        mHead.store(pos + 1, std::memory_order_release);
+    }
+
+    inline std::size_t TraceRing::Snapshot(std::uint64_t* out, std::size_t max) const noexcept
+    {
+        // The slot after the last record may be being written, so at most Capacity - 1 are stable
+        const std::uint64_t end = mHead.load(std::memory_order_acquire);
+        const std::uint64_t available = end < Capacity - 1 ? end : Capacity - 1;
+        const std::uint64_t count = available < max ? available : max;
+        const std::uint64_t begin = end - count;
+        for (std::uint64_t pos = begin; pos < end; ++pos)
+            for (std::size_t w = 0; w < RecordWords; ++w)
+                out[(pos - begin) * RecordWords + w] = mWords[(pos & Mask) * RecordWords + w].load(std::memory_order_relaxed);
+
+        // Drop the records the writer may have overwritten in the meantime
+        std::atomic_thread_fence(std::memory_order_acquire);
+        const std::uint64_t after = mHead.load(std::memory_order_relaxed);
+        const std::uint64_t stable = after + 1 > Capacity ? after + 1 - Capacity : 0;
+        if (stable <= begin)
+            return static_cast<std::size_t>(count);
+        if (stable >= end)
+            return 0;
+        const std::uint64_t kept = end - stable;
+        for (std::uint64_t i = 0; i < kept * RecordWords; ++i)
+            out[i] = out[(stable - begin) * RecordWords + i];
+        return static_cast<std::size_t>(kept);
+    }
+
+    inline std::vector<TraceRecord> TraceRing::Snapshot() const
+    {
+        std::vector<std::uint64_t> words(Capacity * RecordWords);
+        const std::size_t count = Snapshot(words.data(), Capacity);
+        std::vector<TraceRecord> records;
+        records.reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+            records.push_back(Decode(&words[i * RecordWords]));
+        return records;
+    }
+
+    inline TraceRecord TraceRing::Decode(const std::uint64_t* words) noexcept
+    {
+        TraceRecord record;
+        record.timestamp = words[0];
+        record.machine = static_cast<std::uint32_t>(words[1]);
+        record.event = static_cast<std::uint16_t>(words[1] >> 32);
+        record.result = static_cast<EventResult>(words[1] >> 48);
+        record.state = static_cast<std::uint32_t>(words[2]);
+        record.next = static_cast<std::uint32_t>(words[2] >> 32);
+        return record;
+    }
+
+    ///==============================================================
+    ///= TraceObserver
+    ///==============================================================
+    // Observer policy writing every dispatched event into the trace ring of
+    // the dispatching thread, whichever thread that is. Each machine gets a
+    // process wide id on construction, which can be replaced by one of the
+    // application's own. Tracing costs a clock read and a few stores
+    template <class Model>
+    class TraceObserver
+    {
+        public:
+            using StateId = typename Model::StateId;
+
+            TraceObserver() noexcept : mMachineId(NextMachineId()) {}
+
+            template <class Event>
+            void OnDispatch(StateId) noexcept {}
+
+            template <class Event>
+            void OnTransition(StateId prev, StateId next) noexcept { Write<Event>(prev, next, EventResult::Handled); }
+
+            template <class Event>
+            void OnUnhandled(StateId state) noexcept { Write<Event>(state, state, EventResult::Unhandled); }
+
+            template <class Event>
+            void OnDeferred(StateId state) noexcept { Write<Event>(state, state, EventResult::Deferred); }
+
+            void OnStateEntered(StateId) noexcept {}
+
+            void OnStateLeft(StateId) noexcept {}
+
+            /// The id of the machine in its trace records
+            std::uint32_t GetMachineId() const noexcept { return mMachineId; }
+
+            void SetMachineId(std::uint32_t id) noexcept { mMachineId = id; }
+
+        private:
+            static std::uint32_t NextMachineId() noexcept
+            {
+                static std::atomic<std::uint32_t> nextId(0);
+                return nextId.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            template <class Event>
+            static constexpr std::uint16_t EventIndexOf(std::true_type) { return static_cast<std::uint16_t>(Model::template EventIndex<Event>()); }
+
+            template <class Event>
+            static constexpr std::uint16_t EventIndexOf(std::false_type) { return TraceRecord::UnknownEvent; }
+
+            template <class Event>
+            void Write(StateId state, StateId next, EventResult result) noexcept
+            {
+                TraceRing::ForThisThread().Write(LatencyClock::Now(), mMachineId, state,
+                    EventIndexOf<Event>(PackContains<Event, typename Model::Events>()), next, result);
+            }
+
+            std::uint32_t mMachineId;
+    };
+}
+
+#endif // ! _TRACE_RING_HPP_
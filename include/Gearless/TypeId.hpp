@@ -31,7 +31,9 @@
 #ifndef _TYPEID_HPP_
 #define _TYPEID_HPP_
 
+#include <atomic>
 #include <type_traits>
+#include <Gearless/TypeList.hpp>
 
 template<class T, class U=
     typename std::remove_cv<
@@ -54,8 +56,10 @@ namespace Gearless
         protected:
             static TypeId GenTypeId()
             {
-                static TypeId nextId = 0;
-                return nextId++;
+                // Constant initialized, so there is no guard around the counter itself,
+                // and the atomic increment hands out distinct ids to concurrent callers
+                static std::atomic<TypeId> nextId(0);
+                return nextId.fetch_add(1, std::memory_order_relaxed);
             }
     };
 
@@ -65,7 +69,10 @@ namespace Gearless
         public:
             static TypeId GetTypeId()
             {
-                static TypeId tId = TypeIdGenBase::GenTypeId();
+                // Function local statics are initialized exactly once even when several
+                // threads get here first at the same time; once initialized the guard
+                // check is a single lock-free acquire load
+                static const TypeId tId = TypeIdGenBase::GenTypeId();
                 return tId;
             }
     };
@@ -75,6 +82,26 @@ namespace Gearless
     {
         return TypeIdGen<typename remove_all<T>::type>::GetTypeId();
     }
+
+    ///==============================================================
+    ///= TypeIndex
+    ///==============================================================
+    // Compile time alternative to GetTypeId for closed sets of types:
+    // the dense position of T in the given Packer, usable as an array index
+    template <class T, class Pack>
+    struct TypeIndex
+        : std::integral_constant<std::size_t, PackIndexOf<typename remove_all<T>::type, Pack>::value>
+    {
+        static_assert(PackContains<typename remove_all<T>::type, Pack>::value,
+                      "The given type is not part of the indexed type set");
+    };
+
+    // Deduplicated set of the given types, to be indexed with TypeIndex
+    template <class... Types>
+    struct TypeSet
+    {
+        using type = typename PackUnique<Packer<typename remove_all<Types>::type...>>::type;
+    };
 }
 
 #endif // ! _TYPEID_HPP_
@@ -0,0 +1,524 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#ifndef _TYPE_LIST_HPP_
+#define _TYPE_LIST_HPP_
+
+#include <cstddef>
+#include <type_traits>
+
+namespace Gearless
+{
+    ///==============================================================
+    ///= Packer
+    ///==============================================================
+    template <class... Types>
+    struct Packer {};
+
+    ///==============================================================
+    ///= PackSize
+    ///==============================================================
+    template <class Pack>
+    struct PackSize;
+
+    template <class... Types>
+    struct PackSize<Packer<Types...>>
+        : std::integral_constant<std::size_t, sizeof...(Types)> {};
+
+    ///==============================================================
+    ///= IndexSeq
+    ///==============================================================
+    template <std::size_t... Is>
+    struct IndexSeq {};
+
+    template <class Lhs, class Rhs>
+    struct IndexSeqConcat;
+
+    template <std::size_t... Ls, std::size_t... Rs>
+    struct IndexSeqConcat<IndexSeq<Ls...>, IndexSeq<Rs...>>
+    {
+        using type = IndexSeq<Ls..., (sizeof...(Ls) + Rs)...>;
+    };
+
+    // Builds IndexSeq<0, 1, ..., N - 1> with logarithmic instantiation depth
+    template <std::size_t N>
+    struct MakeIndexSeq
+    {
+        using type = typename IndexSeqConcat<
+            typename MakeIndexSeq<N / 2>::type,
+            typename MakeIndexSeq<N - N / 2>::type
+        >::type;
+    };
+
+    template <>
+    struct MakeIndexSeq<0> { using type = IndexSeq<>; };
+
+    template <>
+    struct MakeIndexSeq<1> { using type = IndexSeq<0>; };
+
+    ///==============================================================
+    ///= ConstTable
+    ///==============================================================
+    // Fixed size array as a literal type, which constexpr functions can return
+    template <class T, std::size_t N>
+    struct ConstArray
+    {
+        T values[N == 0 ? 1 : N];
+    };
+
+    // Static storage of the ConstArray returned by Maker::Make(). GCC reads an
+    // element of a static array during constant evaluation in time linear in
+    // the number of template arguments of the class that declares it, so the
+    // arrays read by compile time computations over long packs are declared
+    // here, where the only argument is the class computing them
+    template <class Maker>
+    struct ConstTable
+    {
+        static constexpr decltype(Maker::Make()) table = Maker::Make();
+    };
+
+    template <class Maker>
+    constexpr decltype(Maker::Make()) ConstTable<Maker>::table;
+
+    ///==============================================================
+    ///= SortRowRuns
+    ///==============================================================
+    // Merge path of two sorted runs of distinct values. Every output position
+    // finds how many values of Lhs precede it with a binary search along the
+    // merge path, so the merge is a single pack expansion instead of a
+    // recursion over the values. Only values appear in its arguments, which
+    // keeps the names of its many instantiations short. The counts are
+    // spelled as sizeof... rather than kept in static members, which would
+    // be as slow to read as the values themselves
+    template <class Lhs, class Rhs>
+    struct MergePath;
+
+    template <std::size_t... As, std::size_t... Bs>
+    struct MergePath<IndexSeq<As...>, IndexSeq<Bs...>>
+    {
+        /// The values of Lhs followed by the values of Rhs
+        static constexpr ConstArray<std::size_t, sizeof...(As) + sizeof...(Bs)> Make() { return {{ As..., Bs... }}; }
+
+        static constexpr std::size_t Lhs(std::size_t i) { return ConstTable<MergePath>::table.values[i]; }
+        static constexpr std::size_t Rhs(std::size_t i) { return ConstTable<MergePath>::table.values[sizeof...(As) + i]; }
+
+        /// Whether the first p merged values hold more than the first i values of Lhs
+        static constexpr bool TooFew(std::size_t p, std::size_t i)
+        {
+            return i < sizeof...(As) && p > i && Lhs(i) < Rhs(p - i - 1);
+        }
+
+        /// Number of values of Lhs among the first p merged values, searched in [lo, hi]
+        static constexpr std::size_t Split(std::size_t p, std::size_t lo, std::size_t hi)
+        {
+            return lo == hi ? lo
+                : TooFew(p, lo + (hi - lo) / 2) ? Split(p, lo + (hi - lo) / 2 + 1, hi) : Split(p, lo, lo + (hi - lo) / 2);
+        }
+
+        static constexpr std::size_t At(std::size_t p, std::size_t i)
+        {
+            return i < sizeof...(As) && (p - i >= sizeof...(Bs) || Lhs(i) < Rhs(p - i)) ? Lhs(i) : Rhs(p - i);
+        }
+
+        /// The value at the given position of the merged run
+        static constexpr std::size_t At(std::size_t p)
+        {
+            return At(p, Split(p, p > sizeof...(Bs) ? p - sizeof...(Bs) : 0, p < sizeof...(As) ? p : sizeof...(As)));
+        }
+
+        /// Whether every value of Lhs precedes every value of Rhs
+        static constexpr bool Ordered() { return Lhs(sizeof...(As) - 1) < Rhs(0); }
+    };
+
+    // The merged run of the given merge path. The path is a single argument:
+    // naming anything built from the packs of the runs in the expansion over
+    // the positions would substitute those packs again for every position,
+    // which makes the expansion quadratic in the length of the runs
+    template <class Path, class Positions, bool Ordered = Path::Ordered()>
+    struct MergeSortedRuns;
+
+    template <class Path, std::size_t... Ps>
+    struct MergeSortedRuns<Path, IndexSeq<Ps...>, false>
+    {
+        using type = IndexSeq<Path::At(Ps)...>;
+    };
+
+    // Runs already in order are joined without searching, which makes sorting
+    // the mostly ordered keys of real tables close to linear
+    template <std::size_t... As, std::size_t... Bs, class Positions>
+    struct MergeSortedRuns<MergePath<IndexSeq<As...>, IndexSeq<Bs...>>, Positions, true>
+    {
+        using type = IndexSeq<As..., Bs...>;
+    };
+
+    // The rows in [Lo, Hi) of a table of RowCount rows whose Keys give the
+    // sort key of every row as KeyOf(row), as key * RowCount + row values in
+    // ascending order, which sorts them by key and keeps rows of the same key
+    // in declaration order. Merge sort over halves, so it takes O(T log^2 T)
+    // constant evaluations and a logarithmic instantiation depth for T rows
+    template <class Keys, std::size_t RowCount, std::size_t Lo = 0, std::size_t Hi = RowCount, bool Single = Hi - Lo == 1>
+    struct SortRowRuns
+    {
+        using type = typename MergeSortedRuns<
+            MergePath<
+                typename SortRowRuns<Keys, RowCount, Lo, Lo + (Hi - Lo) / 2>::type,
+                typename SortRowRuns<Keys, RowCount, Lo + (Hi - Lo) / 2, Hi>::type
+            >,
+            typename MakeIndexSeq<Hi - Lo>::type
+        >::type;
+    };
+
+    template <class Keys, std::size_t RowCount, std::size_t Lo, std::size_t Hi>
+    struct SortRowRuns<Keys, RowCount, Lo, Hi, true>
+    {
+        using type = IndexSeq<Keys::KeyOf(Lo) * RowCount + Lo>;
+    };
+
+    ///==============================================================
+    ///= SortedRows
+    ///==============================================================
+    // The rows of a table sorted by the keys Keys gives them, see SortRowRuns,
+    // along with lookups of the rows of a key
+    template <class Keys, class Runs = typename SortRowRuns<Keys, Keys::RowCount>::type>
+    struct SortedRows;
+
+    template <class Keys, std::size_t... Vs>
+    struct SortedRows<Keys, IndexSeq<Vs...>>
+    {
+        /// Every row as key * RowCount + row, in ascending order
+        static constexpr ConstArray<std::size_t, sizeof...(Vs)> Make() { return {{ Vs... }}; }
+
+        /// The row at the given sorted position
+        static constexpr std::size_t RowAt(std::size_t pos) { return ConstTable<SortedRows>::table.values[pos] % sizeof...(Vs); }
+
+        /// Position of the first row whose key * RowCount + row is not less than the given value, in [lo, hi]
+        static constexpr std::size_t LowerBound(std::size_t value, std::size_t lo, std::size_t hi)
+        {
+            return lo == hi ? lo
+                : ConstTable<SortedRows>::table.values[lo + (hi - lo) / 2] < value
+                    ? LowerBound(value, lo + (hi - lo) / 2 + 1, hi)
+                    : LowerBound(value, lo, lo + (hi - lo) / 2);
+        }
+
+        /// Position of the first row of the given key, or of the next key present
+        static constexpr std::size_t Start(std::size_t key) { return LowerBound(key * sizeof...(Vs), 0, sizeof...(Vs)); }
+
+        /// Position of the given row of the given key
+        static constexpr std::size_t PositionOf(std::size_t key, std::size_t row) { return LowerBound(key * sizeof...(Vs) + row, 0, sizeof...(Vs)); }
+    };
+
+    // The rows at the sorted positions [Lo, Lo + N) of the given SortedRows, in that order
+    template <class Sorted, std::size_t Lo, class Seq>
+    struct SortedRowRange;
+
+    template <class Sorted, std::size_t Lo, std::size_t... Is>
+    struct SortedRowRange<Sorted, Lo, IndexSeq<Is...>>
+    {
+        using type = IndexSeq<Sorted::RowAt(Lo + Is)...>;
+    };
+
+    ///==============================================================
+    ///= IndexedPack
+    ///==============================================================
+    template <class T>
+    struct TypeTag
+    {
+        using type = T;
+    };
+
+    // One type of an IndexedPack along with its position
+    template <std::size_t I, class T>
+    struct IndexedType : TypeTag<T> {};
+
+    // Derives from one IndexedType per type of the given Packer. Looking a
+    // type up by position or a position up by type is then a single base
+    // class search done by the compiler, where a recursion over the types
+    // would instantiate one template per type skipped and per lookup
+    template <class Pack, class Seq = typename MakeIndexSeq<PackSize<Pack>::value>::type>
+    struct IndexedPack;
+
+    template <class... Types, std::size_t... Is>
+    struct IndexedPack<Packer<Types...>, IndexSeq<Is...>> : IndexedType<Is, Types>... {};
+
+    // Deduces the position of the only base holding T, or falls back to None
+    // if there is no such base or more than one
+    template <class T, std::size_t None, std::size_t I>
+    std::integral_constant<std::size_t, I> PositionLookup(const IndexedType<I, T>*);
+
+    template <class T, std::size_t None>
+    std::integral_constant<std::size_t, None> PositionLookup(...);
+
+    // Deduces the type held by the base at position I
+    template <std::size_t I, class T>
+    TypeTag<T> TypeLookup(const IndexedType<I, T>*);
+
+    ///==============================================================
+    ///= PackContains
+    ///==============================================================
+    template <class T, class Pack>
+    struct PackContains : std::is_base_of<TypeTag<T>, IndexedPack<Pack>> {};
+
+    ///==============================================================
+    ///= PackIndexOf
+    ///==============================================================
+    // Position of T in the given Packer, which holds it at most once, or the
+    // Packer's size if T is not in it
+    template <class T, class Pack>
+    struct PackIndexOf
+        : decltype(PositionLookup<T, PackSize<Pack>::value>(static_cast<IndexedPack<Pack>*>(nullptr))) {};
+
+    ///==============================================================
+    ///= PackPushBack
+    ///==============================================================
+    template <class Pack, class T>
+    struct PackPushBack;
+
+    template <class... Types, class T>
+    struct PackPushBack<Packer<Types...>, T>
+    {
+        using type = Packer<Types..., T>;
+    };
+
+    ///==============================================================
+    ///= PackAt
+    ///==============================================================
+    // Splits the given types into Packers of up to 16 of them, appended to Blocks
+    template <class Blocks, class... Types>
+    struct PackBlocks
+    {
+        using type = typename PackPushBack<Blocks, Packer<Types...>>::type;
+    };
+
+    template <class Blocks>
+    struct PackBlocks<Blocks>
+    {
+        using type = Blocks;
+    };
+
+    template <class Blocks, class T0, class T1, class T2, class T3, class T4, class T5, class T6, class T7,
+              class T8, class T9, class T10, class T11, class T12, class T13, class T14, class T15, class... Rest>
+    struct PackBlocks<Blocks, T0, T1, T2, T3, T4, T5, T6, T7, T8, T9, T10, T11, T12, T13, T14, T15, Rest...>
+    {
+        using type = typename PackBlocks<
+            typename PackPushBack<Blocks, Packer<T0, T1, T2, T3, T4, T5, T6, T7, T8, T9, T10, T11, T12, T13, T14, T15>>::type,
+            Rest...
+        >::type;
+    };
+
+    template <class Pack>
+    struct PackBlocksOf;
+
+    template <class... Types>
+    struct PackBlocksOf<Packer<Types...>>
+    {
+        using type = typename PackBlocks<Packer<>, Types...>::type;
+    };
+
+    // The type at position I of the given Packer. A base class search costs
+    // the compiler time linear in the number of bases, so longer Packers are
+    // split in blocks of 16 types, recursively, and searched block by block
+    template <std::size_t I, class Pack, bool Short = (PackSize<Pack>::value <= 16)>
+    struct PackAt
+    {
+        using type = typename decltype(TypeLookup<I>(static_cast<IndexedPack<Pack>*>(nullptr)))::type;
+    };
+
+    template <std::size_t I, class Pack>
+    struct PackAt<I, Pack, false>
+    {
+        using type = typename PackAt<I % 16,
+            typename PackAt<I / 16, typename PackBlocksOf<Pack>::type>::type>::type;
+    };
+
+    // The types at the given positions of the given Packer, in the order of the positions
+    template <class Pack, class Positions>
+    struct PackSelect;
+
+    template <class Pack, std::size_t... Is>
+    struct PackSelect<Pack, IndexSeq<Is...>>
+    {
+        using type = Packer<typename PackAt<Is, Pack>::type...>;
+    };
+
+    ///==============================================================
+    ///= PackFront
+    ///==============================================================
+    // The first type of the given Packer, or void if it is empty
+    template <class Pack>
+    struct PackFront
+    {
+        using type = void;
+    };
+
+    template <class First, class... Rest>
+    struct PackFront<Packer<First, Rest...>>
+    {
+        using type = First;
+    };
+
+    ///==============================================================
+    ///= PackConcat
+    ///==============================================================
+    template <class... Packs>
+    struct PackConcat
+    {
+        using type = Packer<>;
+    };
+
+    template <class... Types>
+    struct PackConcat<Packer<Types...>>
+    {
+        using type = Packer<Types...>;
+    };
+
+    template <class... As, class... Bs>
+    struct PackConcat<Packer<As...>, Packer<Bs...>>
+    {
+        using type = Packer<As..., Bs...>;
+    };
+
+    // Merges sixteen packs per step on long lists. Every step takes the
+    // compiler time linear in the number of packs left, so the fewer steps
+    // the better
+    template <class... A0, class... A1, class... A2, class... A3, class... A4, class... A5, class... A6, class... A7,
+              class... A8, class... A9, class... A10, class... A11, class... A12, class... A13, class... A14, class... A15,
+              class... Rest>
+    struct PackConcat<Packer<A0...>, Packer<A1...>, Packer<A2...>, Packer<A3...>,
+                      Packer<A4...>, Packer<A5...>, Packer<A6...>, Packer<A7...>,
+                      Packer<A8...>, Packer<A9...>, Packer<A10...>, Packer<A11...>,
+                      Packer<A12...>, Packer<A13...>, Packer<A14...>, Packer<A15...>, Rest...>
+    {
+        using type = typename PackConcat<Packer<
+            A0..., A1..., A2..., A3..., A4..., A5..., A6..., A7...,
+            A8..., A9..., A10..., A11..., A12..., A13..., A14..., A15...
+        >, Rest...>::type;
+    };
+
+    // Merges four packs per step to keep the instantiation depth low on long lists
+    template <class... As, class... Bs, class... Cs, class... Ds, class... Rest>
+    struct PackConcat<Packer<As...>, Packer<Bs...>, Packer<Cs...>, Packer<Ds...>, Rest...>
+    {
+        using type = typename PackConcat<Packer<As..., Bs..., Cs..., Ds...>, Rest...>::type;
+    };
+
+    template <class... As, class... Bs, class... Cs>
+    struct PackConcat<Packer<As...>, Packer<Bs...>, Packer<Cs...>>
+    {
+        using type = Packer<As..., Bs..., Cs...>;
+    };
+
+    ///==============================================================
+    ///= PackFilter
+    ///==============================================================
+    // Keeps the types for which Pred<T>::value holds, in their original order
+    template <template <class> class Pred, class Pack>
+    struct PackFilter;
+
+    template <template <class> class Pred, class... Types>
+    struct PackFilter<Pred, Packer<Types...>>
+    {
+        using type = typename PackConcat<
+            typename std::conditional<Pred<Types>::value, Packer<Types>, Packer<>>::type...
+        >::type;
+    };
+
+    ///==============================================================
+    ///= PackUnique
+    ///==============================================================
+    // Removes duplicate types keeping the position of their first occurrence.
+    // The types kept so far are also the bases of a chain of TypeSetNodes, so
+    // that checking a type against them is one base class search instead of
+    // one template instantiation per kept type. Each node adds a single base,
+    // where deriving from all the kept types at once would lay out a class
+    // as large as the result for every type kept
+    struct TypeSetRoot {};
+
+    template <class Prev, class T>
+    struct TypeSetNode : Prev, TypeTag<T> {};
+
+    template <class Kept, class Set>
+    struct UniqueSoFar
+    {
+        using type = Kept;
+        using set = Set;
+    };
+
+    template <class Result, class T, bool Seen = std::is_base_of<TypeTag<T>, typename Result::set>::value>
+    struct PackAppendUnique
+    {
+        using type = UniqueSoFar<typename PackPushBack<typename Result::type, T>::type,
+                                 TypeSetNode<typename Result::set, T>>;
+    };
+
+    template <class Result, class T>
+    struct PackAppendUnique<Result, T, true>
+    {
+        using type = Result;
+    };
+
+    template <class Result, class... Types>
+    struct PackUniqueImpl
+    {
+        using type = typename Result::type;
+    };
+
+    template <class Result, class T, class... Rest>
+    struct PackUniqueImpl<Result, T, Rest...>
+    {
+        using type = typename PackUniqueImpl<typename PackAppendUnique<Result, T>::type, Rest...>::type;
+    };
+
+    // Appends four types per step to keep the instantiation depth low on long lists
+    template <class Result, class T0, class T1, class T2, class T3, class... Rest>
+    struct PackUniqueImpl<Result, T0, T1, T2, T3, Rest...>
+    {
+        using type = typename PackUniqueImpl<
+            typename PackAppendUnique<
+                typename PackAppendUnique<
+                    typename PackAppendUnique<
+                        typename PackAppendUnique<Result, T0>::type,
+                    T1>::type,
+                T2>::type,
+            T3>::type,
+            Rest...
+        >::type;
+    };
+
+    template <class Pack>
+    struct PackUnique;
+
+    template <class... Types>
+    struct PackUnique<Packer<Types...>>
+    {
+        using type = typename PackUniqueImpl<UniqueSoFar<Packer<>, TypeSetRoot>, Types...>::type;
+    };
+}
+
+#endif // ! _TYPE_LIST_HPP_
@@ -0,0 +1,136 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#ifndef _UNHANDLED_POLICY_HPP_
+#define _UNHANDLED_POLICY_HPP_
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <Gearless/TypeList.hpp>
+
+namespace Gearless
+{
+    ///==============================================================
+    ///= IgnoreUnhandled
+    ///==============================================================
+    // The unhandled policy of a state machine is a class template taking the
+    // machine's model, kept as a base class like the observer policy. It is
+    // told of every event that no transition of the current state accepts,
+    // events outside the transition table and replayed deferred events
+    // included. The default policy drops them without a trace
+    template <class Model>
+    struct IgnoreUnhandled
+    {
+        using StateId = typename Model::StateId;
+
+        /// No transition of the given state accepted the event
+        template <class Event>
+        void OnUnhandledEvent(StateId, const Event&) noexcept {}
+    };
+
+    ///==============================================================
+    ///= CountUnhandled
+    ///==============================================================
+    // Counts the unhandled events, for cheap health checks of long running
+    // machines
+    template <class Model>
+    class CountUnhandled
+    {
+        public:
+            using StateId = typename Model::StateId;
+
+            CountUnhandled() noexcept : mCount(0) {}
+
+            template <class Event>
+            void OnUnhandledEvent(StateId, const Event&) noexcept { ++mCount; }
+
+            /// Number of events dropped since construction or the last Reset
+            std::uint64_t GetUnhandledCount() const noexcept { return mCount; }
+
+            void Reset() noexcept { mCount = 0; }
+
+        private:
+            std::uint64_t mCount;
+    };
+
+    ///==============================================================
+    ///= CallbackOnUnhandled
+    ///==============================================================
+    // Calls a run time callback with the state and the dense index of the
+    // event, which is the EventCount of the model for events outside the
+    // transition table. Nothing is called until a callback is set
+    template <class Model>
+    class CallbackOnUnhandled
+    {
+        public:
+            using StateId = typename Model::StateId;
+            using Callback = void (*)(void* context, StateId state, std::size_t event);
+
+            CallbackOnUnhandled() noexcept : mCallback(nullptr), mContext(nullptr) {}
+
+            template <class Event>
+            void OnUnhandledEvent(StateId state, const Event&)
+            {
+                if (mCallback)
+                    mCallback(mContext, state, PackIndexOf<Event, typename Model::Events>::value);
+            }
+
+            /// Sets the function called on unhandled events along with its first argument
+            void SetUnhandledCallback(Callback callback, void* context = nullptr) noexcept
+            {
+                mCallback = callback;
+                mContext = context;
+            }
+
+        private:
+            Callback mCallback;
+            void* mContext;
+    };
+
+    ///==============================================================
+    ///= AssertOnUnhandled
+    ///==============================================================
+    // Treats unhandled events as programming errors in debug builds, for
+    // machines whose table is meant to cover every event in every state
+    template <class Model>
+    struct AssertOnUnhandled
+    {
+        using StateId = typename Model::StateId;
+
+        template <class Event>
+        void OnUnhandledEvent(StateId, const Event&) noexcept
+        {
+            assert(false && "No transition of the current state handles the event");
+        }
+    };
+}
+
+#endif // ! _UNHANDLED_POLICY_HPP_
@@ -69,31 +69,40 @@ void CloseDrawer(const OpenClose&) { std::cout << "Drawer closed." << std::endl;
 void StoreCdInfo(const CdDetected& cd) { std::cout << "Cd Detected! " << "Name: " << cd.mName << std::endl; }
 void StartPlayback(const Play&) { std::cout << "Playback started!" << std::endl; }
 void PausePlayback(const Pause&) { std::cout << "Playback paused." << std::endl; }
-void ResumePlayback(const Play&) { std::cout << "Playback resumed!" << std::endl; }
+void ResumePlayback(const EndPause&) { std::cout << "Playback resumed!" << std::endl; }
 void StopPlayback(const Stop&) { std::cout << "Playback stopped!" << std::endl; }
 void StopAndOpen(const OpenClose&) { std::cout << "Playback stopped! Drawer is oppening..." << std::endl; }
 void StoppedAgain(const Stop&) { std::cout << "Playback already stopped." << std::endl; }
 
+///==============================================================
+///= Transition Guards
+///==============================================================
+bool IsAudioCd(const CdDetected& cd) { return cd.mDiskType == DiskType::Cd; }
+bool IsDvd(const CdDetected& cd) { return cd.mDiskType == DiskType::Dvd; }
+
 ///==============================================================
 ///= Transition Table
 ///==============================================================
 // Aliases to make the transition table more compact
-template <class PrevState, class Event, class NextState, typename Fn>
-using tr = Gearless::Transition<PrevState, Event, NextState, Fn>;
+template <class PrevState, class Event, class NextState, typename Fn, typename Guard = Gearless::NoGuard>
+using tr = Gearless::Transition<PrevState, Event, NextState, Fn, Guard>;
 
 using OpenDrawerW  = Gearless::TFunct<OpenClose, OpenDrawer>;
 using CloseDrawerW = Gearless::TFunct<OpenClose, CloseDrawer>;
 using StoreCdInfoW = Gearless::TFunct<CdDetected, StoreCdInfo>;
 using StartPlaybackW = Gearless::TFunct<Play, StartPlayback>;
 using PausePlaybackW = Gearless::TFunct<Pause, PausePlayback>;
-using ResumePlaybackW = Gearless::TFunct<Play, ResumePlayback>;
+using ResumePlaybackW = Gearless::TFunct<EndPause, ResumePlayback>;
 using StopPlaybackW = Gearless::TFunct<Stop, StopPlayback>;
 using StopAndOpenW = Gearless::TFunct<OpenClose, StopAndOpen>;
 using StoppedAgainW = Gearless::TFunct<Stop, StoppedAgain>;
 
+using IsAudioCdG = Gearless::TGuard<CdDetected, IsAudioCd>;
+using IsDvdG = Gearless::TGuard<CdDetected, IsDvd>;
+
 // The transition table
 using TransitionTbl = Gearless::Packer<
-    //    Start     Event         Next      Action				 Guard
+    //    Start     Event         Next      Action                Guard
     //  +---------+-------------+---------+---------------------+---------------+
      tr < Stopped , Play        , Playing , StartPlaybackW                      >,
      tr < Stopped , OpenClose   , Open    , OpenDrawerW                         >,
@@ -102,8 +111,8 @@ using TransitionTbl = Gearless::Packer<
      tr < Open    , OpenClose   , Empty   , CloseDrawerW                        >,
     //  +---------+-------------+---------+---------------------+---------------+
      tr < Empty   , OpenClose   , Open    , OpenDrawerW                         >,
-     tr < Empty   , CdDetected  , Stopped , StoreCdInfoW                        >,
-     tr < Empty   , CdDetected  , Playing , StoreCdInfoW                        >,
+     tr < Empty   , CdDetected  , Stopped , StoreCdInfoW        , IsAudioCdG    >,
+     tr < Empty   , CdDetected  , Playing , StoreCdInfoW        , IsDvdG        >,
     //  +---------+-------------+---------+---------------------+---------------+
      tr < Playing , Stop        , Stopped , StopPlaybackW                       >,
      tr < Playing , Pause       , Paused  , PausePlaybackW                      >,
@@ -133,6 +142,11 @@ void Test()
     sm.ProcessEvent(Pause());
     sm.ProcessEvent(Stop());
     sm.ProcessEvent(Stop());
+    // A dvd starts playing right away
+    sm.ProcessEvent(OpenClose());
+    sm.ProcessEvent(OpenClose());
+    sm.ProcessEvent(CdDetected("Saturday Night Fever", DiskType::Dvd));
+    sm.ProcessEvent(Stop());
     sm.Stop();
 }
 
@@ -0,0 +1,116 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+#include <Gearless/StateMachine.hpp>
+
+///==============================================================
+///= Generated ring
+///==============================================================
+// A ring of RingSize leaf states split into four sectors. Every state has
+// a guarded and a fallback row stepping around the ring and a row for one
+// of eight jump events, and inherits a row of its sector. Building the
+// model of such a table once took the compiler time superlinear in the
+// rows, so this file is expected to keep compiling within seconds
+namespace
+{
+    constexpr std::size_t RingSize = 128;
+    constexpr std::size_t SectorSize = RingSize / 4;
+
+    struct Step { bool forward; };
+    struct Home {};
+    template <std::size_t I> struct Jump {};
+
+    template <std::size_t G> struct Sector;
+    template <std::size_t I> struct Cell { using Parent = Sector<I / SectorSize>; };
+    template <std::size_t G> struct Sector { using Initial = Cell<G * SectorSize>; };
+
+    bool Forward(const Step& s) { return s.forward; }
+
+    template <class Cells, class Sectors>
+    struct RingTbl;
+
+    template <std::size_t... Is, std::size_t... Gs>
+    struct RingTbl<Gearless::IndexSeq<Is...>, Gearless::IndexSeq<Gs...>>
+    {
+        using type = Gearless::Packer<
+            Gearless::Transition<Cell<Is>, Step, Cell<(Is + 1) % RingSize>, Gearless::NoAction, Gearless::TGuard<Step, Forward>>...,
+            Gearless::Transition<Cell<Is>, Step, Cell<(Is + RingSize - 1) % RingSize>>...,
+            Gearless::Transition<Cell<Is>, Jump<Is % 8>, Cell<0>>...,
+            Gearless::Transition<Sector<Gs>, Home, Cell<Gs * SectorSize + 1>>...
+        >;
+    };
+
+    using Ring = Gearless::StateMachine<Cell<0>, RingTbl<
+        Gearless::MakeIndexSeq<RingSize>::type, Gearless::MakeIndexSeq<4>::type>::type>;
+}
+
+TEST_CASE("StateMachine builds the model of tables with hundreds of rows", "[CompileTime]")
+{
+    Ring sm;
+    sm.Start();
+
+    SECTION ("Check that every state gets its own index")
+    {
+        REQUIRE(Ring::StateCount == RingSize);
+        REQUIRE(Ring::Model::TransitionCount == 4 * RingSize);
+    }
+
+    SECTION ("Check that guarded rows fall back to the later rows of their pair")
+    {
+        sm.ProcessEvent(Step{true});
+        sm.ProcessEvent(Step{true});
+        REQUIRE(sm.IsInState<Cell<2>>());
+        sm.ProcessEvent(Step{false});
+        REQUIRE(sm.IsInState<Cell<1>>());
+        for (std::size_t i = 0; i < 2; ++i)
+            sm.ProcessEvent(Step{false});
+        REQUIRE(sm.IsInState<Cell<RingSize - 1>>());
+    }
+
+    SECTION ("Check that each state only handles its own jump event")
+    {
+        sm.ProcessEvent(Step{true});
+        sm.ProcessEvent(Jump<2>{});
+        REQUIRE(sm.IsInState<Cell<1>>());
+        sm.ProcessEvent(Jump<1>{});
+        REQUIRE(sm.IsInState<Cell<0>>());
+    }
+
+    SECTION ("Check that states inherit the rows of their sector")
+    {
+        for (std::size_t i = 0; i < SectorSize; ++i)
+            sm.ProcessEvent(Step{true});
+        REQUIRE(sm.IsInState<Sector<1>>());
+        sm.ProcessEvent(Home{});
+        REQUIRE(sm.IsInState<Cell<SectorSize + 1>>());
+    }
+}
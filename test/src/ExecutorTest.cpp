@@ -0,0 +1,201 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <Gearless/Executor.hpp>
+#include <Gearless/StateMachine.hpp>
+
+///==============================================================
+///= Worker machine
+///==============================================================
+namespace
+{
+    struct Counter
+    {
+        std::atomic<bool> busy;
+        unsigned count;
+    };
+
+    struct Work { Counter* counter; };
+    struct Toggle {};
+
+    struct Even {};
+    struct Odd {};
+
+    std::atomic<bool> overlapped(false);
+    std::atomic<unsigned> processed(0);
+
+    void OnWork(const Work& w)
+    {
+        // The same machine must never be processed by two workers at once
+        if (w.counter->busy.exchange(true))
+            overlapped = true;
+        ++w.counter->count;
+        w.counter->busy.store(false);
+        ++processed;
+    }
+
+    using WorkerTbl = Gearless::Packer<
+        Gearless::Transition< Even, Work, Odd , Gearless::TFunct<Work, OnWork> >,
+        Gearless::Transition< Odd , Work, Even, Gearless::TFunct<Work, OnWork> >
+    >;
+
+    using WorkerMachine = Gearless::StateMachine<Even, WorkerTbl>;
+    using WorkerActor = Gearless::Actor<WorkerMachine, 256>;
+
+    bool WaitFor(unsigned expected)
+    {
+        for (int i = 0; i < 2000 && processed.load() < expected; ++i)
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        return processed.load() == expected;
+    }
+}
+
+TEST_CASE("Executor runs actors from many producers without overlapping a machine", "[Executor]")
+{
+    const unsigned actorCount = 32, producerCount = 4, perProducer = 500;
+    processed = 0;
+    std::vector<Counter> counters(actorCount);
+    for (Counter& c : counters)
+        c.busy = false, c.count = 0;
+
+    Gearless::Executor executor(4);
+    std::vector<std::unique_ptr<WorkerActor>> actors;
+    for (unsigned a = 0; a < actorCount; ++a)
+        actors.emplace_back(new WorkerActor(executor));
+
+    std::vector<std::thread> producers;
+    for (unsigned p = 0; p < producerCount; ++p)
+    {
+        producers.emplace_back([&]()
+        {
+            for (unsigned i = 0; i < perProducer; ++i)
+                for (unsigned a = 0; a < actorCount; ++a)
+                    while (!actors[a]->PostEvent(Work{&counters[a]}))
+                        std::this_thread::yield();
+        });
+    }
+    for (std::thread& t : producers)
+        t.join();
+
+    REQUIRE(WaitFor(actorCount * producerCount * perProducer));
+    REQUIRE(!overlapped);
+    bool allCounted = true;
+    for (unsigned a = 0; a < actorCount; ++a)
+        allCounted = allCounted && counters[a].count == producerCount * perProducer;
+    REQUIRE(allCounted);
+    // Every actor saw an even number of events, so every machine is back where it started
+    bool allEven = true;
+    for (unsigned a = 0; a < actorCount; ++a)
+        allEven = allEven && actors[a]->GetMachine().IsInState<Even>();
+    REQUIRE(allEven);
+}
+
+TEST_CASE("Executor wakes idle workers for late events", "[Executor]")
+{
+    processed = 0;
+    Counter counter;
+    counter.busy = false;
+    counter.count = 0;
+    Gearless::Executor executor(2);
+    WorkerActor actor(executor);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    actor.PostEvent(Work{&counter});
+    REQUIRE(WaitFor(1));
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    actor.PostEvent(Work{&counter});
+    REQUIRE(WaitFor(2));
+    REQUIRE(actor.GetMachine().IsInState<Even>());
+}
+
+///==============================================================
+///= Fairness
+///==============================================================
+namespace
+{
+    // Holds its worker until released, so that tasks pile up behind it
+    struct Blocker : Gearless::Executor::Task
+    {
+        std::atomic<bool> started{false};
+        std::atomic<bool> released{false};
+
+        void Run() override
+        {
+            started = true;
+            while (!released)
+                std::this_thread::yield();
+        }
+    };
+
+    Counter* busyCounter = nullptr;
+    std::atomic<unsigned> busySeenByQuiet(0);
+
+    void OnQuiet(const Toggle&) { busySeenByQuiet = busyCounter->count; }
+
+    using QuietTbl = Gearless::Packer<
+        Gearless::Transition< Even, Toggle, Odd, Gearless::TFunct<Toggle, OnQuiet> >
+    >;
+
+    using BusyActor = Gearless::Actor<WorkerMachine, 8192>;
+    using QuietActor = Gearless::Actor<Gearless::StateMachine<Even, QuietTbl>, 16>;
+}
+
+TEST_CASE("Executor lets other tasks run between the budgets of a busy actor", "[Executor]")
+{
+    const unsigned busyEvents = 4000;
+    processed = 0;
+    Counter counter;
+    counter.busy = false;
+    counter.count = 0;
+    busyCounter = &counter;
+
+    Gearless::Executor executor(1);
+    BusyActor busy(executor);
+    QuietActor quiet(executor);
+
+    Blocker blocker;
+    executor.Schedule(&blocker);
+    while (!blocker.started)
+        std::this_thread::yield();
+
+    for (unsigned i = 0; i < busyEvents; ++i)
+        busy.PostEvent(Work{&counter});
+    quiet.PostEvent(Toggle{});
+    blocker.released = true;
+
+    REQUIRE(WaitFor(busyEvents));
+    REQUIRE(quiet.GetMachine().IsInState<Odd>());
+    REQUIRE(busySeenByQuiet <= BusyActor::RunBudget);
+}
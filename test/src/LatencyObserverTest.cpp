@@ -0,0 +1,252 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <Gearless/LatencyObserver.hpp>
+#include <Gearless/StateMachine.hpp>
+
+///==============================================================
+///= Histogram
+///==============================================================
+TEST_CASE("LatencyHistogram records samples into log-linear buckets", "[LatencyObserver]")
+{
+    using Histogram = Gearless::LatencyHistogram<3, 20>;
+
+    SECTION ("Check that small values get a bucket each and larger ones a bounded relative error")
+    {
+        REQUIRE(Histogram::BucketOf(0) == 0);
+        REQUIRE(Histogram::BucketOf(7) == 7);
+        REQUIRE(Histogram::BucketOf(8) == 8);
+        REQUIRE(Histogram::BucketOf(15) == 15);
+        REQUIRE(Histogram::BucketOf(16) == 16);
+        REQUIRE(Histogram::BucketOf(17) == 16);
+        REQUIRE(Histogram::UpperBound(16) == 17);
+
+        bool bounded = true;
+        for (std::uint64_t v = 1; v < (1u << 20); v = v * 3 / 2 + 1)
+        {
+            const std::uint64_t upper = Histogram::UpperBound(Histogram::BucketOf(v));
+            bounded = bounded && upper >= v && (upper - v) * 8 <= v;
+        }
+        REQUIRE(bounded);
+    }
+
+    SECTION ("Check that out of range values end up in the last bucket")
+    {
+        REQUIRE(Histogram::BucketOf(1u << 20) == Histogram::BucketCount - 1);
+        REQUIRE(Histogram::BucketOf(~std::uint64_t(0)) == Histogram::BucketCount - 1);
+    }
+
+    SECTION ("Check that percentiles are found to the bucket precision")
+    {
+        Histogram h;
+        for (std::uint64_t v = 1; v <= 1000; ++v)
+            h.Record(v);
+        REQUIRE(h.Count() == 1000);
+        REQUIRE(h.Max() == 1000);
+        REQUIRE(h.Percentile(0.0) == 1);
+        REQUIRE(h.Percentile(0.5) >= 500);
+        REQUIRE(h.Percentile(0.5) <= 500 + 500 / 8);
+        REQUIRE(h.Percentile(0.99) >= 990);
+        REQUIRE(h.Percentile(1.0) == 1000);
+
+        h.Reset();
+        REQUIRE(h.Count() == 0);
+        REQUIRE(h.Percentile(0.5) == 0);
+    }
+}
+
+///==============================================================
+///= Oven
+///==============================================================
+// The actions advance a fake clock by a known amount of ticks
+namespace
+{
+    std::uint64_t ticks = 0;
+
+    struct FakeClock
+    {
+        static std::uint64_t Now() noexcept { return ticks; }
+    };
+
+    template <class Model>
+    using FakeLatencyObserver = Gearless::BasicLatencyObserver<Model, FakeClock>;
+
+    template <class Model>
+    using FakeSharedLatencyObserver = Gearless::BasicSharedLatencyObserver<Model, FakeClock>;
+
+    struct Heat { unsigned cost; };
+    struct Cool {};
+
+    struct Cold {};
+    struct Warm {};
+    struct Hot {};
+
+    void OnHeat(const Heat& h) { ticks += h.cost; }
+    void OnCool(const Cool&) { ticks += 5; }
+
+    bool IsMild(const Heat& h) { return h.cost < 100; }
+
+    template <class PrevState, class Event, class NextState, typename Fn, typename Guard = Gearless::NoGuard>
+    using tr = Gearless::Transition<PrevState, Event, NextState, Fn, Guard>;
+
+    using OvenTbl = Gearless::Packer<
+        tr< Cold , Heat , Warm , Gearless::TFunct<Heat, OnHeat> , Gearless::TGuard<Heat, IsMild> >,
+        tr< Cold , Heat , Hot  , Gearless::TFunct<Heat, OnHeat>                                  >,
+        tr< Warm , Cool , Cold , Gearless::TFunct<Cool, OnCool>                                  >,
+        tr< Hot  , Cool , Warm , Gearless::TFunct<Cool, OnCool>                                  >
+    >;
+
+    using Oven = Gearless::StateMachine<Cold, OvenTbl, Gearless::DenseDispatch, 16, FakeLatencyObserver>;
+
+    template <class Policy>
+    void CheckOven()
+    {
+        using Machine = Gearless::StateMachine<Cold, OvenTbl, Policy, 16, FakeLatencyObserver>;
+        Machine oven;
+        oven.Start();
+        for (unsigned i = 1; i <= 3; ++i)
+        {
+            oven.ProcessEvent(Heat{i});
+            oven.ProcessEvent(Cool{});
+            oven.ProcessEvent(Heat{1000 * i});
+            oven.ProcessEvent(Cool{});
+            oven.ProcessEvent(Cool{});
+        }
+        using Histogram = typename Machine::Observer::Histogram;
+        const typename Machine::Observer& latency = oven.GetObserver();
+        const Histogram& mild = latency.template GetHistogram<Cold, Heat, Warm>();
+        const Histogram& strong = latency.template GetHistogram<Cold, Heat, Hot>();
+        const Histogram& cooling = latency.template GetHistogram<Hot, Cool, Warm>();
+        REQUIRE(mild.Count() == 3);
+        REQUIRE(strong.Count() == 3);
+        REQUIRE(strong.Max() == 3000);
+        REQUIRE(cooling.Count() == 3);
+    }
+}
+
+TEST_CASE("LatencyObserver times every transition separately", "[LatencyObserver]")
+{
+    Oven oven;
+    oven.Start();
+    for (unsigned i = 1; i <= 10; ++i)
+    {
+        oven.ProcessEvent(Heat{i});
+        oven.ProcessEvent(Cool{});
+        oven.ProcessEvent(Heat{1000 * i});
+        oven.ProcessEvent(Cool{});
+        oven.ProcessEvent(Cool{});
+    }
+    oven.ProcessEvent(Heat{1});
+    oven.ProcessEvent(Heat{1});
+
+    const Oven::Observer& latency = oven.GetObserver();
+
+    SECTION ("Check that transitions sharing a state and event get their own histogram")
+    {
+        const Oven::Observer::Histogram& mild = latency.GetHistogram<Cold, Heat, Warm>();
+        const Oven::Observer::Histogram& strong = latency.GetHistogram<Cold, Heat, Hot>();
+        REQUIRE(mild.Count() == 11);
+        REQUIRE(mild.Max() == 10);
+        REQUIRE(strong.Count() == 10);
+        REQUIRE(strong.Max() == 10000);
+        REQUIRE(strong.Percentile(0.5) >= 5000);
+        REQUIRE(strong.Percentile(0.5) < 6000);
+    }
+
+    SECTION ("Check that the dump lists every timed transition with its percentiles")
+    {
+        std::ostringstream out;
+        latency.Dump(out);
+        const std::string dump = out.str();
+        INFO(dump);
+        REQUIRE(dump.find("state 0 --event 0--> state 1: count 11, p50 5, p90 9,") == 0);
+        REQUIRE(dump.find("state 0 --event 0--> state 2: count 10,") != std::string::npos);
+        REQUIRE(dump.find("state 2 --event 1--> state 1: count 10, p50 5, p90 5, p99 5, p99.9 5, max 5") != std::string::npos);
+
+        std::size_t lines = 0;
+        latency.ForEach([&lines](std::size_t, std::size_t, std::size_t, const Oven::Observer::Histogram&) { ++lines; });
+        REQUIRE(lines == 4);
+    }
+
+    SECTION ("Check that transitions are told apart with every dispatch policy")
+    {
+        CheckOven<Gearless::LinearDispatch>();
+        CheckOven<Gearless::SwitchDispatch>();
+        CheckOven<Gearless::SortedDispatch>();
+        CheckOven<Gearless::SparseDispatch>();
+    }
+
+    SECTION ("Check that the real clocks move forward")
+    {
+        const std::uint64_t start = Gearless::LatencyClock::Now();
+        const std::uint64_t steady = Gearless::SteadyClock::Now();
+        REQUIRE(Gearless::LatencyClock::Now() >= start);
+        REQUIRE(Gearless::SteadyClock::Now() >= steady);
+    }
+}
+
+TEST_CASE("SharedLatencyObserver records into a table outside of the machine", "[LatencyObserver]")
+{
+    using Shared = Gearless::StateMachine<Cold, OvenTbl, Gearless::DenseDispatch, 16, FakeSharedLatencyObserver>;
+    using Table = Shared::Observer::Table;
+
+    SECTION ("Check that the observer only adds a pointer and a start time to the machine")
+    {
+        REQUIRE(sizeof(Shared::Observer) == 2 * sizeof(std::uint64_t));
+        REQUIRE(sizeof(Oven::Observer) > sizeof(Table));
+    }
+
+    SECTION ("Check that machines sharing a table add up their samples")
+    {
+        Table table;
+        Shared a, b, untimed;
+        a.GetObserver().SetTable(&table);
+        b.GetObserver().SetTable(&table);
+        a.Start();
+        b.Start();
+        untimed.Start();
+        a.ProcessEvent(Heat{3});
+        b.ProcessEvent(Heat{7});
+        untimed.ProcessEvent(Heat{11});
+        b.ProcessEvent(Cool{});
+
+        const Table::Histogram& mild = table.GetHistogram<Cold, Heat, Warm>();
+        const Table::Histogram& cooling = table.GetHistogram<Warm, Cool, Cold>();
+        REQUIRE(mild.Count() == 2);
+        REQUIRE(mild.Max() == 7);
+        REQUIRE(cooling.Count() == 1);
+        REQUIRE(untimed.GetObserver().GetTable() == nullptr);
+    }
+}
@@ -0,0 +1,168 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+#include <string>
+#include <thread>
+#include <vector>
+#include <Gearless/Mailbox.hpp>
+#include <Gearless/StateMachine.hpp>
+
+///==============================================================
+///= Sequencer
+///==============================================================
+namespace
+{
+    struct Item
+    {
+        unsigned producer;
+        unsigned seq;
+    };
+    struct Text
+    {
+        std::string value;
+    };
+
+    struct Idle {};
+
+    const unsigned producerCount = 4;
+    unsigned received = 0;
+    unsigned lastSeq[producerCount];
+    bool ordered = true;
+    std::string text;
+
+    void OnItem(const Item& it)
+    {
+        // Events of one producer must arrive in the order they were posted
+        ordered = ordered && (lastSeq[it.producer] == 0 || it.seq == lastSeq[it.producer] + 1);
+        lastSeq[it.producer] = it.seq;
+        ++received;
+    }
+
+    void OnText(const Text& t) { text += t.value; }
+
+    using SequencerTbl = Gearless::Packer<
+        Gearless::Transition< Idle, Item, Idle, Gearless::TFunct<Item, OnItem> >,
+        Gearless::Transition< Idle, Text, Idle, Gearless::TFunct<Text, OnText> >
+    >;
+
+    using Sequencer = Gearless::StateMachine<Idle, SequencerTbl>;
+
+    struct Tracked
+    {
+        static int alive;
+        Tracked() { ++alive; }
+        Tracked(const Tracked&) { ++alive; }
+        ~Tracked() { --alive; }
+    };
+    int Tracked::alive = 0;
+
+    struct TrackedSink
+    {
+        void ProcessEvent(const Tracked&) {}
+    };
+}
+
+TEST_CASE("Mailbox queues events for a single consumer", "[Mailbox]")
+{
+    text.clear();
+    Sequencer sm;
+    sm.Start();
+
+    SECTION ("Check that events are drained in posting order")
+    {
+        Gearless::Mailbox<Sequencer, 4> mailbox;
+        REQUIRE(mailbox.Empty());
+        REQUIRE(mailbox.PostEvent(Text{"a"}));
+        REQUIRE(mailbox.PostEvent(Text{"b"}));
+        REQUIRE(!mailbox.Empty());
+        REQUIRE(mailbox.Drain(sm, 1) == 1);
+        REQUIRE(mailbox.PostEvent(Text{"c"}));
+        REQUIRE(mailbox.Drain(sm) == 2);
+        REQUIRE(mailbox.Empty());
+        REQUIRE(text == "abc");
+    }
+
+    SECTION ("Check that posting to a full mailbox fails without losing queued events")
+    {
+        Gearless::Mailbox<Sequencer, 2> mailbox;
+        REQUIRE(mailbox.PostEvent(Text{"x"}));
+        REQUIRE(mailbox.PostEvent(Text{"y"}));
+        REQUIRE(!mailbox.PostEvent(Text{"z"}));
+        REQUIRE(mailbox.Drain(sm) == 2);
+        REQUIRE(mailbox.PostEvent(Text{"z"}));
+        REQUIRE(mailbox.Drain(sm) == 1);
+        REQUIRE(text == "xyz");
+    }
+
+    SECTION ("Check that drained and undrained events are both destroyed")
+    {
+        {
+            Gearless::Mailbox<TrackedSink, 8> mailbox;
+            TrackedSink sink;
+            mailbox.PostEvent(Tracked());
+            mailbox.PostEvent(Tracked());
+            mailbox.PostEvent(Tracked());
+            mailbox.Drain(sink, 1);
+            REQUIRE(Tracked::alive == 2);
+        }
+        REQUIRE(Tracked::alive == 0);
+    }
+}
+
+TEST_CASE("Mailbox accepts events from many producer threads", "[Mailbox]")
+{
+    const unsigned perProducer = 20000;
+    Sequencer sm;
+    sm.Start();
+    Gearless::Mailbox<Sequencer, 256> mailbox;
+
+    std::vector<std::thread> producers;
+    for (unsigned p = 0; p < producerCount; ++p)
+    {
+        producers.emplace_back([&mailbox, p, perProducer]()
+        {
+            for (unsigned i = 1; i <= perProducer; ++i)
+                while (!mailbox.PostEvent(Item{p, i}))
+                    std::this_thread::yield();
+        });
+    }
+
+    while (received < producerCount * perProducer)
+        if (mailbox.Drain(sm) == 0)
+            std::this_thread::yield();
+    for (std::thread& t : producers)
+        t.join();
+
+    REQUIRE(received == producerCount * perProducer);
+    REQUIRE(ordered);
+    REQUIRE(mailbox.Empty());
+}
@@ -0,0 +1,158 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+#include <string>
+#include <Gearless/OrthogonalStateMachine.hpp>
+
+///==============================================================
+///= Protocol
+///==============================================================
+// Transport, session and keepalive regions, where LinkDown
+// concerns both the transport and the session
+namespace
+{
+    struct LinkUp {};
+    struct LinkDown {};
+    struct Login {};
+    struct Ping {};
+    struct Timeout {};
+
+    struct Down {};
+    struct Up {};
+
+    struct NoSession { static void OnEntry(); };
+    struct InSession {};
+
+    struct Waiting {};
+    struct Pinged {};
+    struct Missed1 {};
+    struct Missed2 {};
+    struct Expired {};
+
+    std::string trace;
+    void NoSession::OnEntry() { trace += "+NoSession;"; }
+    void OnLinkDown(const LinkDown&) { trace += "down;"; }
+    void OnLogout(const LinkDown&) { trace += "logout;"; }
+
+    template <class PrevState, class Event, class NextState, typename Fn = Gearless::NoAction>
+    using tr = Gearless::Transition<PrevState, Event, NextState, Fn>;
+
+    using Transport = Gearless::Region<Down, Gearless::Packer<
+        tr< Down , LinkUp   , Up                                     >,
+        tr< Up   , LinkDown , Down , Gearless::TFunct<LinkDown, OnLinkDown> >
+    >>;
+
+    using Session = Gearless::Region<NoSession, Gearless::Packer<
+        tr< NoSession , Login    , InSession                                 >,
+        tr< InSession , LinkDown , NoSession , Gearless::TFunct<LinkDown, OnLogout> >
+    >>;
+
+    using Keepalive = Gearless::Region<Waiting, Gearless::Packer<
+        tr< Waiting , Ping    , Pinged  >,
+        tr< Pinged  , Ping    , Pinged  >,
+        tr< Waiting , Timeout , Missed1 >,
+        tr< Pinged  , Timeout , Waiting >,
+        tr< Missed1 , Timeout , Missed2 >,
+        tr< Missed2 , Timeout , Expired >,
+        tr< Missed1 , Ping    , Pinged  >,
+        tr< Missed2 , Ping    , Pinged  >
+    >>;
+
+    using Protocol = Gearless::OrthogonalStateMachine<Transport, Session, Keepalive>;
+}
+
+TEST_CASE("OrthogonalStateMachine packs the states of its regions into one integer", "[OrthogonalStateMachine]")
+{
+    SECTION ("Check that every region gets a bit field sized to its state count")
+    {
+        REQUIRE(Protocol::RegionCount == 3);
+        REQUIRE(Protocol::StateBits == 1 + 1 + 3);
+        REQUIRE(sizeof(Protocol) == 1);
+        REQUIRE(Gearless::PackSize<Protocol::Events>::value == 5);
+    }
+
+    SECTION ("Check that each region keeps its own state")
+    {
+        Protocol sm;
+        sm.Start();
+        sm.ProcessEvent(LinkUp{});
+        sm.ProcessEvent(Timeout{});
+        sm.ProcessEvent(Timeout{});
+        REQUIRE(sm.IsInState<Up>());
+        REQUIRE(sm.IsInState<NoSession>());
+        REQUIRE(sm.IsInState<Missed2>());
+        REQUIRE(sm.GetRegionState<2>() == Keepalive::Model::StateIndex<Missed2>());
+    }
+
+    SECTION ("Check that packed states can be saved and restored")
+    {
+        Protocol sm;
+        sm.Start();
+        sm.ProcessEvent(Login{});
+        sm.ProcessEvent(Ping{});
+        Protocol other;
+        other.RestoreState(sm.GetState());
+        REQUIRE(other.IsInState<InSession>());
+        REQUIRE(other.IsInState<Pinged>());
+        REQUIRE(other.IsInState<Down>());
+    }
+}
+
+TEST_CASE("OrthogonalStateMachine dispatches events to the regions handling them", "[OrthogonalStateMachine]")
+{
+    trace.clear();
+    Protocol sm;
+    sm.Start();
+    REQUIRE(trace == "+NoSession;");
+
+    SECTION ("Check that an event shared by regions fires in each of them in region order")
+    {
+        sm.ProcessEvent(LinkUp{});
+        sm.ProcessEvent(Login{});
+        sm.ProcessEvent(Ping{});
+        sm.ProcessEvent(LinkDown{});
+        REQUIRE(trace == "+NoSession;down;logout;+NoSession;");
+        REQUIRE(sm.IsInState<Down>());
+        REQUIRE(sm.IsInState<NoSession>());
+        REQUIRE(sm.IsInState<Pinged>());
+    }
+
+    SECTION ("Check that regions not handling an event keep their state")
+    {
+        for (int i = 0; i < 4; ++i)
+            sm.ProcessEvent(Timeout{});
+        sm.ProcessEvent(std::string("unknown"));
+        REQUIRE(sm.IsInState<Expired>());
+        REQUIRE(sm.IsInState<Down>());
+        REQUIRE(sm.IsInState<NoSession>());
+    }
+}
@@ -0,0 +1,129 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+///==============================================================
+///= Recording probes
+///==============================================================
+// Stand in for <sys/sdt.h>, so that the probes of the machine are built
+// with GEARLESS_USDT on every platform and record what they would report
+namespace
+{
+    struct ProbeHit
+    {
+        std::string name;
+        std::vector<std::uint64_t> args;
+    };
+
+    std::vector<ProbeHit> hits;
+
+    std::uint64_t ProbeArg(const void* p) { return static_cast<std::uint64_t>(reinterpret_cast<std::uintptr_t>(p)); }
+    std::uint64_t ProbeArg(unsigned v) { return v; }
+
+    void RecordProbe(const char* provider, const char* name, std::vector<std::uint64_t> args)
+    {
+        REQUIRE(std::string(provider) == "gearless");
+        hits.push_back(ProbeHit{name, args});
+    }
+}
+
+#define DTRACE_PROBE2(provider, name, a1, a2) \
+    RecordProbe(#provider, #name, { ProbeArg(a1), ProbeArg(a2) })
+#define DTRACE_PROBE5(provider, name, a1, a2, a3, a4, a5) \
+    RecordProbe(#provider, #name, { ProbeArg(a1), ProbeArg(a2), ProbeArg(a3), ProbeArg(a4), ProbeArg(a5) })
+#define GEARLESS_USDT
+
+#include <Gearless/StateMachine.hpp>
+
+///==============================================================
+///= Gate
+///==============================================================
+namespace
+{
+    struct Coin {};
+    struct Push {};
+    struct Hold {};
+
+    struct Locked {};
+    struct Unlocked {};
+
+    using GateTbl = Gearless::Packer<
+        Gearless::Transition< Locked   , Coin , Unlocked >,
+        Gearless::Transition< Unlocked , Push , Locked   >,
+        Gearless::Defer< Locked , Push >
+    >;
+
+    using Gate = Gearless::StateMachine<Locked, GateTbl>;
+
+    std::uint64_t Result(Gearless::EventResult result) { return static_cast<std::uint64_t>(result); }
+}
+
+TEST_CASE("StateMachine fires its static tracepoints with the dispatch outcome", "[Probes]")
+{
+    hits.clear();
+    Gate gate;
+    const std::uint64_t self = ProbeArg(static_cast<const void*>(&gate));
+    const std::uint64_t locked = Gate::StateIndex<Locked>();
+    const std::uint64_t unlocked = Gate::StateIndex<Unlocked>();
+    const std::uint64_t coin = Gate::EventIndex<Coin>();
+    const std::uint64_t push = Gate::EventIndex<Push>();
+
+    gate.Start();
+    gate.ProcessEvent(Push{});
+    gate.ProcessEvent(Coin{});
+    gate.ProcessEvent(Hold{});
+    gate.Stop();
+
+    REQUIRE(hits.size() == 6);
+
+    SECTION ("Check that start and stop report the machine and its state")
+    {
+        REQUIRE(hits[0].name == "start");
+        REQUIRE(hits[0].args == std::vector<std::uint64_t>({ self, locked }));
+        REQUIRE(hits[5].name == "stop");
+        REQUIRE(hits[5].args == std::vector<std::uint64_t>({ self, locked }));
+    }
+
+    SECTION ("Check that every dispatch, replayed ones included, reports its states, event and result")
+    {
+        using Gearless::EventResult;
+        const std::uint64_t unknown = Gate::EventCount;
+        REQUIRE(hits[1].name == "process_event");
+        REQUIRE(hits[1].args == std::vector<std::uint64_t>({ self, locked, push, locked, Result(EventResult::Deferred) }));
+        REQUIRE(hits[2].args == std::vector<std::uint64_t>({ self, locked, coin, unlocked, Result(EventResult::Handled) }));
+        REQUIRE(hits[3].args == std::vector<std::uint64_t>({ self, unlocked, push, locked, Result(EventResult::Handled) }));
+        REQUIRE(hits[4].args == std::vector<std::uint64_t>({ self, locked, unknown, locked, Result(EventResult::Unhandled) }));
+    }
+}
@@ -0,0 +1,237 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <Gearless/ShardedMachineRegistry.hpp>
+#include <Gearless/StateMachine.hpp>
+
+///==============================================================
+///= Door
+///==============================================================
+namespace
+{
+    struct Open {};
+    struct Close {};
+
+    struct Opened {};
+    struct Closed {};
+
+    using DoorTbl = Gearless::Packer<
+        Gearless::Transition< Closed, Open , Opened >,
+        Gearless::Transition< Opened, Close, Closed >
+    >;
+
+    using Door = Gearless::StateMachine<Closed, DoorTbl>;
+    using DoorRegistry = Gearless::ShardedMachineRegistry<std::uint64_t, Door>;
+
+    // Doors that hold knocks while closed, under keys with no default value
+    struct Knock {};
+
+    using KnockTbl = Gearless::Packer<
+        Gearless::Transition< Closed, Open , Opened >,
+        Gearless::Transition< Opened, Knock, Opened >,
+        Gearless::Transition< Opened, Close, Closed >,
+        Gearless::Defer< Closed, Knock >
+    >;
+
+    using KnockDoor = Gearless::StateMachine<Closed, KnockTbl, Gearless::DenseDispatch, 4, Gearless::CountingObserver>;
+
+    struct DoorId
+    {
+        explicit DoorId(std::uint64_t v) : value(v) {}
+        bool operator==(const DoorId& other) const { return value == other.value; }
+        std::uint64_t value;
+    };
+
+    struct DoorIdHash
+    {
+        std::size_t operator()(const DoorId& id) const { return static_cast<std::size_t>(id.value); }
+    };
+
+    using KnockRegistry = Gearless::ShardedMachineRegistry<DoorId, KnockDoor, DoorIdHash>;
+}
+
+TEST_CASE("Registry routes events to machines by key", "[ShardedMachineRegistry]")
+{
+    DoorRegistry registry(8);
+    REQUIRE(registry.ShardCount() == 8);
+
+    SECTION ("Check that inserted keys are found and unknown ones are not")
+    {
+        const std::uint64_t count = 5000;
+        for (std::uint64_t k = 0; k < count; ++k)
+            registry.Insert(k * 7);
+        REQUIRE(registry.Size() == count);
+
+        bool allFound = true;
+        for (std::uint64_t k = 0; k < count; ++k)
+            allFound = allFound && registry.Find(k * 7) != nullptr && registry.Find(k * 7 + 1) == nullptr;
+        REQUIRE(allFound);
+
+        // Keys spread over every shard
+        bool allUsed = true;
+        for (std::size_t s = 0; s < registry.ShardCount(); ++s)
+            allUsed = allUsed && registry.GetShard(s).Size() > 0;
+        REQUIRE(allUsed);
+    }
+
+    SECTION ("Check that erasing keeps the remaining keys reachable")
+    {
+        const std::uint64_t count = 3000;
+        for (std::uint64_t k = 0; k < count; ++k)
+            registry.Insert(k);
+        bool allErased = true;
+        for (std::uint64_t k = 0; k < count; k += 2)
+            allErased = allErased && registry.Erase(k);
+        REQUIRE(allErased);
+        REQUIRE(!registry.Erase(0));
+        REQUIRE(registry.Size() == count / 2);
+
+        bool consistent = true;
+        for (std::uint64_t k = 0; k < count; ++k)
+            consistent = consistent && (registry.Find(k) != nullptr) == (k % 2 == 1);
+        REQUIRE(consistent);
+    }
+
+    SECTION ("Check that events only reach the machine of their key")
+    {
+        registry.Insert(1);
+        registry.Insert(2);
+        REQUIRE(registry.ProcessEvent(1, Open{}));
+        REQUIRE(!registry.ProcessEvent(3, Open{}));
+        REQUIRE(registry.Find(1)->IsInState<Opened>());
+        REQUIRE(registry.Find(2)->IsInState<Closed>());
+        // Inserting an existing key keeps its machine
+        REQUIRE(registry.Insert(1).IsInState<Opened>());
+    }
+}
+
+TEST_CASE("Registry holds machines with deferred events under keys without default value", "[ShardedMachineRegistry]")
+{
+    KnockRegistry registry(2);
+    const std::uint64_t count = 1000;
+    for (std::uint64_t k = 0; k < count; ++k)
+    {
+        registry.Insert(DoorId(k)).Start();
+        registry.ProcessEvent(DoorId(k), Knock{});
+    }
+
+    // Growing and erasing relocate the machines along with their queued knocks
+    for (std::uint64_t k = 0; k < count; k += 2)
+        registry.Erase(DoorId(k));
+    REQUIRE(registry.Size() == count / 2);
+
+    bool allQueued = true;
+    for (std::uint64_t k = 1; k < count; k += 2)
+        allQueued = allQueued && registry.Find(DoorId(k))->GetDeferredCount() == 1;
+    REQUIRE(allQueued);
+
+    REQUIRE(registry.ProcessEvent(DoorId(1), Open{}));
+    const KnockDoor& door = *registry.Find(DoorId(1));
+    REQUIRE(door.GetDeferredCount() == 0);
+    const std::uint64_t knocks = door.GetObserver().Hits<Opened, Knock>();
+    REQUIRE(knocks == 1);
+    REQUIRE(door.GetObserver().Deferred() == 1);
+}
+
+TEST_CASE("Registry slot arrays start on cache lines of their own", "[ShardedMachineRegistry]")
+{
+    Gearless::CacheLineAllocator<char> alloc;
+    bool aligned = true;
+    for (std::size_t n = 1; n < 300; n += 37)
+    {
+        char* p = alloc.allocate(n);
+        aligned = aligned && reinterpret_cast<std::uintptr_t>(p) % 64 == 0;
+        for (std::size_t i = 0; i < n; ++i)
+            p[i] = 'x';
+        alloc.deallocate(p, n);
+    }
+    REQUIRE(aligned);
+
+    DoorRegistry registry(4);
+    for (std::uint64_t k = 0; k < 100; ++k)
+        registry.Insert(k);
+    bool linesOwned = true;
+    for (std::size_t s = 0; s < registry.ShardCount(); ++s)
+    {
+        std::uintptr_t lowest = ~std::uintptr_t(0);
+        registry.GetShard(s).ForEach([&lowest](std::uint64_t, Door& d)
+        {
+            const std::uintptr_t at = reinterpret_cast<std::uintptr_t>(&d);
+            lowest = at < lowest ? at : lowest;
+        });
+        // No other shard's machines live on the lines of this one
+        for (std::size_t o = 0; o < registry.ShardCount(); ++o)
+            if (o != s)
+                registry.GetShard(o).ForEach([&linesOwned, lowest](std::uint64_t, Door& d)
+                {
+                    linesOwned = linesOwned && reinterpret_cast<std::uintptr_t>(&d) / 64 != lowest / 64;
+                });
+    }
+    REQUIRE(linesOwned);
+}
+
+TEST_CASE("Registry shards are processed by one thread each", "[ShardedMachineRegistry]")
+{
+    DoorRegistry registry(4);
+    const std::uint64_t count = 4000;
+    for (std::uint64_t k = 0; k < count; ++k)
+        registry.Insert(k);
+
+    // Each thread opens the doors of its own shard, inserting and erasing along the way
+    std::vector<std::thread> owners;
+    for (std::size_t s = 0; s < registry.ShardCount(); ++s)
+    {
+        owners.emplace_back([&registry, s, count]()
+        {
+            for (std::uint64_t k = 0; k < count; ++k)
+                if (registry.ShardOf(k) == s)
+                    registry.ProcessEvent(k, Open{});
+            for (std::uint64_t k = count; k < 2 * count; ++k)
+                if (registry.ShardOf(k) == s)
+                    registry.Insert(k);
+            for (std::uint64_t k = count; k < 2 * count; ++k)
+                if (registry.ShardOf(k) == s)
+                    registry.Erase(k);
+        });
+    }
+    for (std::thread& t : owners)
+        t.join();
+
+    REQUIRE(registry.Size() == count);
+    std::size_t opened = 0;
+    for (std::size_t s = 0; s < registry.ShardCount(); ++s)
+        registry.GetShard(s).ForEach([&opened](std::uint64_t, Door& d) { opened += d.IsInState<Opened>(); });
+    REQUIRE(opened == count);
+}
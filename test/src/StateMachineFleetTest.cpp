@@ -0,0 +1,261 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+#include <string>
+#include <Gearless/StateMachineFleet.hpp>
+
+///==============================================================
+///= Turnstile
+///==============================================================
+namespace
+{
+    struct Coin {};
+    struct Push {};
+
+    struct Locked {};
+    struct Unlocked {};
+
+    int pushes = 0;
+
+    void OnPush(const Push&) { ++pushes; }
+
+    template <class PrevState, class Event, class NextState, typename Fn = Gearless::NoAction>
+    using tr = Gearless::Transition<PrevState, Event, NextState, Fn>;
+
+    using TurnstileTbl = Gearless::Packer<
+        tr< Locked   , Coin , Unlocked                                >,
+        tr< Unlocked , Push , Locked   , Gearless::TFunct<Push, OnPush> >
+    >;
+
+    using Fleet = Gearless::StateMachineFleet<Locked, TurnstileTbl>;
+
+    ///==============================================================
+    ///= Counter
+    ///==============================================================
+    // A ring of N states stepping forward on every tick
+    struct Tick {};
+    struct Reset {};
+
+    template <std::size_t I>
+    struct Step {};
+
+    int resets = 0;
+
+    void OnReset(const Reset&) { ++resets; }
+
+    template <std::size_t N, class Seq>
+    struct RingTbl;
+
+    template <std::size_t N, std::size_t... Is>
+    struct RingTbl<N, Gearless::IndexSeq<Is...>>
+    {
+        using type = Gearless::Packer<
+            tr< Step<Is>, Tick, Step<(Is + 1) % N> >...,
+            tr< Step<N - 1>, Reset, Step<0>, Gearless::TFunct<Reset, OnReset> >
+        >;
+    };
+
+    template <std::size_t N>
+    using Ring = Gearless::StateMachineFleet<Step<0>, typename RingTbl<N, typename Gearless::MakeIndexSeq<N>::type>::type>;
+
+    template <std::size_t N>
+    void CheckRingBatches()
+    {
+        resets = 0;
+        const std::size_t count = 1000;
+        Ring<N> fleet(count);
+        // Spread the machines over all the states, then step them all at once
+        for (std::size_t h = 0; h < count; ++h)
+            for (std::size_t k = 0; k < h % N; ++k)
+                fleet.ProcessEvent(h, Tick{});
+        fleet.ProcessEvent(Tick{});
+        bool allStepped = true;
+        for (std::size_t h = 0; h < count; ++h)
+            allStepped = allStepped && fleet.GetState(h) == (h % N + 1) % N;
+        REQUIRE(allStepped);
+
+        // Only the machines in the last state react to resets
+        fleet.ProcessEvent(Reset{}, 1, count);
+        std::size_t expected = 0;
+        for (std::size_t h = 1; h < count; ++h)
+            expected += (h % N + 1) % N == N - 1;
+        REQUIRE(resets == static_cast<int>(expected));
+        REQUIRE(fleet.GetState(N - 2) == 0);
+    }
+}
+
+TEST_CASE("StateMachineFleet dispatches events to machines selected by handle, range or mask", "[StateMachineFleet]")
+{
+    pushes = 0;
+    Fleet fleet(130);
+
+    SECTION ("Check that new machines start in the initial state and are stored compactly")
+    {
+        Fleet::Handle h = fleet.Add();
+        REQUIRE(h == 130);
+        REQUIRE(fleet.Size() == 131);
+        REQUIRE(fleet.IsInState<Locked>(h));
+        REQUIRE(sizeof(Fleet::StateId) == 1);
+    }
+
+    SECTION ("Check that posting to a handle only affects that machine")
+    {
+        fleet.ProcessEvent(7, Coin{});
+        REQUIRE(fleet.IsInState<Unlocked>(7));
+        REQUIRE(fleet.IsInState<Locked>(6));
+        REQUIRE(fleet.IsInState<Locked>(8));
+    }
+
+    SECTION ("Check that a range dispatch affects exactly the machines of the range")
+    {
+        fleet.ProcessEvent(Coin{}, 10, 20);
+        fleet.ProcessEvent(Push{}, 0, 15);
+        REQUIRE(pushes == 5);
+        REQUIRE(fleet.IsInState<Locked>(14));
+        REQUIRE(fleet.IsInState<Unlocked>(15));
+        REQUIRE(fleet.IsInState<Unlocked>(19));
+        REQUIRE(fleet.IsInState<Locked>(20));
+    }
+
+    SECTION ("Check that a mask dispatch affects exactly the selected machines")
+    {
+        std::uint64_t mask[3] = { 0x1, 0x8000000000000000ull, 0x2 };
+        fleet.ProcessEvent(Coin{}, mask);
+        REQUIRE(fleet.IsInState<Unlocked>(0));
+        REQUIRE(fleet.IsInState<Unlocked>(127));
+        REQUIRE(fleet.IsInState<Unlocked>(129));
+        REQUIRE(fleet.IsInState<Locked>(1));
+        REQUIRE(fleet.IsInState<Locked>(128));
+        fleet.ProcessEvent(Push{});
+        REQUIRE(pushes == 3);
+    }
+
+    SECTION ("Check that the mask bits past the last machine are ignored")
+    {
+        std::uint64_t mask[3] = { 0, 0, ~0ull };
+        fleet.ProcessEvent(Coin{}, mask);
+        REQUIRE(fleet.IsInState<Unlocked>(128));
+        REQUIRE(fleet.IsInState<Unlocked>(129));
+        REQUIRE(fleet.IsInState<Locked>(127));
+    }
+}
+
+///==============================================================
+///= Coin gate
+///==============================================================
+// Only coins of the right value unlock, so range dispatch has to
+// evaluate the guard for every machine
+namespace
+{
+    struct Token { int value; };
+
+    bool IsValid(const Token& t) { return t.value == 2; }
+
+    using GateTbl = Gearless::Packer<
+        Gearless::Transition< Locked   , Token , Unlocked , Gearless::NoAction             , Gearless::TGuard<Token, IsValid> >,
+        Gearless::Transition< Unlocked , Push  , Locked   , Gearless::TFunct<Push, OnPush> , Gearless::NoGuard                 >
+    >;
+}
+
+TEST_CASE("StateMachineFleet evaluates guards for every machine in a range", "[StateMachineFleet]")
+{
+    Gearless::StateMachineFleet<Locked, GateTbl> fleet(8);
+    fleet.ProcessEvent(Token{1}, 0, 8);
+    bool allLocked = true;
+    for (std::size_t h = 0; h < 8; ++h)
+        allLocked = allLocked && fleet.IsInState<Locked>(h);
+    REQUIRE(allLocked);
+
+    fleet.ProcessEvent(Token{2}, 2, 5);
+    REQUIRE(fleet.IsInState<Locked>(1));
+    REQUIRE(fleet.IsInState<Unlocked>(2));
+    REQUIRE(fleet.IsInState<Unlocked>(4));
+    REQUIRE(fleet.IsInState<Locked>(5));
+}
+
+TEST_CASE("StateMachineFleet batch dispatch matches single machine dispatch", "[StateMachineFleet]")
+{
+    SECTION ("Check machines small enough for shuffle lookups")
+    {
+        CheckRingBatches<5>();
+        CheckRingBatches<16>();
+    }
+
+    SECTION ("Check machines that need byte sized gathers")
+    {
+        CheckRingBatches<40>();
+    }
+
+    SECTION ("Check machines that need word sized gathers")
+    {
+        CheckRingBatches<300>();
+    }
+}
+
+TEST_CASE("StateMachineFleet processes batches of mixed events", "[StateMachineFleet]")
+{
+    pushes = 0;
+    Fleet fleet(4);
+    Gearless::EventBatch<Fleet::Model> batch;
+
+    SECTION ("Check that events for the same machine keep their posting order")
+    {
+        batch.Post(0, Coin{});
+        batch.Post(1, Push{});
+        batch.Post(0, Push{});
+        batch.Post(1, Coin{});
+        batch.Post(2, Coin{});
+        batch.Post(2, Push{});
+        batch.Post(2, Coin{});
+        batch.Post(3, std::string("unknown"));
+        REQUIRE(batch.Size() == 7);
+
+        fleet.ProcessEvents(batch);
+        REQUIRE(fleet.IsInState<Locked>(0));
+        REQUIRE(fleet.IsInState<Unlocked>(1));
+        REQUIRE(fleet.IsInState<Unlocked>(2));
+        REQUIRE(fleet.IsInState<Locked>(3));
+        REQUIRE(pushes == 2);
+    }
+
+    SECTION ("Check that a cleared batch can be reused")
+    {
+        batch.Post(3, Coin{});
+        fleet.ProcessEvents(batch);
+        batch.Clear();
+        batch.Post(3, Push{});
+        fleet.ProcessEvents(batch);
+        REQUIRE(batch.Size() == 1);
+        REQUIRE(fleet.IsInState<Locked>(3));
+        REQUIRE(pushes == 1);
+    }
+}
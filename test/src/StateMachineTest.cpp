@@ -0,0 +1,1153 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+#include <string>
+#include <type_traits>
+#include <Gearless/StateMachine.hpp>
+
+///==============================================================
+///= Turnstile
+///==============================================================
+namespace
+{
+    struct Coin { int value; };
+    struct Push {};
+    struct Kick {};
+
+    struct Locked {};
+    struct Unlocked {};
+    struct Broken {};
+
+    std::string trace;
+
+    void OnCoin(const Coin& c) { trace += "coin" + std::to_string(c.value) + ";"; }
+    void OnPush(const Push&) { trace += "push;"; }
+    void OnKick(const Kick&) { trace += "kick;"; }
+    void OnKickAgain(const Kick&) { trace += "kick-again;"; }
+
+    template <class PrevState, class Event, class NextState, typename Fn>
+    using tr = Gearless::Transition<PrevState, Event, NextState, Fn>;
+
+    using TurnstileTbl = Gearless::Packer<
+        tr< Locked   , Coin , Unlocked , Gearless::TFunct<Coin, OnCoin>      >,
+        tr< Unlocked , Push , Locked   , Gearless::TFunct<Push, OnPush>      >,
+        tr< Locked   , Kick , Broken   , Gearless::TFunct<Kick, OnKick>      >,
+        tr< Locked   , Kick , Unlocked , Gearless::TFunct<Kick, OnKickAgain> >
+    >;
+
+    using Turnstile = Gearless::StateMachine<Locked, TurnstileTbl>;
+
+    struct OnRepair
+    {
+        void operator()(const Kick&) const { trace += "repair;"; }
+    };
+
+    using RepairTbl = Gearless::Packer<
+        tr< Locked   , Kick , Broken   , Gearless::TFunct<Kick, OnKick> >,
+        tr< Broken   , Kick , Locked   , OnRepair                       >,
+        tr< Locked   , Coin , Locked   , Gearless::NoAction             >
+    >;
+
+    template <class Policy>
+    void CheckTurnstile()
+    {
+        Gearless::StateMachine<Locked, TurnstileTbl, Policy> sm;
+        sm.Start();
+        sm.ProcessEvent(Push{});
+        sm.ProcessEvent(Kick{});
+        sm.ProcessEvent(Coin{1});
+        REQUIRE(sm.template IsInState<Broken>());
+    }
+
+    ///==============================================================
+    ///= Ring
+    ///==============================================================
+    // 2N states where every odd one steps forward on ticks
+    // and the first N ones rewind to the start
+    struct Tick {};
+    struct Rewind {};
+
+    template <std::size_t I>
+    struct Step {};
+
+    template <std::size_t N, class Seq>
+    struct RingTbl;
+
+    template <std::size_t N, std::size_t... Is>
+    struct RingTbl<N, Gearless::IndexSeq<Is...>>
+    {
+        using type = Gearless::Packer<
+            Gearless::Transition< Step<Is>, Rewind, Step<0> >...,
+            Gearless::Transition< Step<Is * 2 + 1>, Tick, Step<(Is * 2 + 2) % (2 * N)> >...
+        >;
+    };
+
+    template <std::size_t N, class Policy>
+    using Ring = Gearless::StateMachine<Step<0>, typename RingTbl<N, typename Gearless::MakeIndexSeq<N>::type>::type, Policy>;
+
+    template <std::size_t N, class Policy>
+    void CheckRing()
+    {
+        using Machine = Ring<N, Policy>;
+        using StateId = typename Machine::StateId;
+        Machine sm;
+        sm.Start();
+        sm.ProcessEvent(Tick{});
+        REQUIRE(sm.template IsInState<Step<0>>());
+        sm.RestoreState(static_cast<StateId>(Machine::template StateIndex<Step<3>>()));
+        sm.ProcessEvent(Tick{});
+        REQUIRE(sm.template IsInState<Step<4>>());
+        sm.ProcessEvent(Tick{});
+        REQUIRE(sm.template IsInState<Step<4>>());
+        sm.RestoreState(static_cast<StateId>(Machine::template StateIndex<Step<1>>()));
+        sm.ProcessEvent(Rewind{});
+        REQUIRE(sm.template IsInState<Step<0>>());
+        sm.RestoreState(static_cast<StateId>(Machine::template StateIndex<Step<2 * N - 1>>()));
+        sm.ProcessEvent(Rewind{});
+        REQUIRE(sm.template IsInState<Step<2 * N - 1>>());
+        sm.ProcessEvent(Tick{});
+        REQUIRE(sm.template IsInState<Step<0>>());
+    }
+}
+
+TEST_CASE("StateMachine assigns dense indices to its states and events", "[StateMachine]")
+{
+    SECTION ("Check that the initial state comes first and the rest follow declaration order")
+    {
+        static_assert(Turnstile::StateIndex<Locked>() == 0, "StateIndex must be a constant expression");
+        REQUIRE(Turnstile::StateCount == 3);
+        REQUIRE(Turnstile::StateIndex<Unlocked>() == 1);
+        REQUIRE(Turnstile::StateIndex<Broken>() == 2);
+    }
+
+    SECTION ("Check that duplicate events share a single index")
+    {
+        REQUIRE(Turnstile::EventCount == 3);
+        REQUIRE(Turnstile::EventIndex<Coin>() == 0);
+        REQUIRE(Turnstile::EventIndex<Push>() == 1);
+        REQUIRE(Turnstile::EventIndex<const Kick&>() == 2);
+    }
+}
+
+TEST_CASE("StateMachine dispatches events through its transition table", "[StateMachine]")
+{
+    trace.clear();
+    Turnstile sm;
+    sm.Start();
+
+    SECTION ("Check that matching transitions fire their actions with the given event")
+    {
+        sm.ProcessEvent(Coin{5});
+        sm.ProcessEvent(Push{});
+        REQUIRE(trace == "coin5;push;");
+    }
+
+    SECTION ("Check that events without a transition from the current state are ignored")
+    {
+        sm.ProcessEvent(Push{});
+        sm.ProcessEvent(Coin{1});
+        sm.ProcessEvent(Coin{2});
+        REQUIRE(trace == "coin1;");
+    }
+
+    SECTION ("Check that events unknown to the table are ignored")
+    {
+        sm.ProcessEvent(std::string("unknown"));
+        sm.ProcessEvent(Coin{1});
+        REQUIRE(trace == "coin1;");
+    }
+
+    SECTION ("Check that the first declared transition wins for duplicate (state, event) pairs")
+    {
+        sm.ProcessEvent(Kick{});
+        sm.ProcessEvent(Coin{1});
+        sm.ProcessEvent(Kick{});
+        REQUIRE(trace == "kick;");
+    }
+}
+
+TEST_CASE("StateMachine accepts function, functor and empty transition actions", "[StateMachine]")
+{
+    trace.clear();
+    Gearless::StateMachine<Locked, RepairTbl> sm;
+    sm.Start();
+
+    sm.ProcessEvent(Kick{});
+    sm.ProcessEvent(Kick{});
+    sm.ProcessEvent(Coin{1});
+    sm.ProcessEvent(Kick{});
+    REQUIRE(trace == "kick;repair;kick;");
+}
+
+TEST_CASE("StateMachine instances share the transition table of their type", "[StateMachine]")
+{
+    SECTION ("Check that an instance is no bigger than its compact state index")
+    {
+        REQUIRE(sizeof(Turnstile) == sizeof(std::uint8_t));
+    }
+
+    SECTION ("Check that instances are plain values which are cheap to copy")
+    {
+        REQUIRE(std::is_trivially_copyable<Turnstile>::value);
+    }
+
+    SECTION ("Check that copies evolve independently of each other")
+    {
+        trace.clear();
+        Turnstile a;
+        a.Start();
+        a.ProcessEvent(Coin{1});
+        Turnstile b = a;
+        b.ProcessEvent(Push{});
+        a.ProcessEvent(Coin{2});
+        REQUIRE(trace == "coin1;push;");
+    }
+}
+
+TEST_CASE("StateMachine exposes its compact current state", "[StateMachine]")
+{
+    Turnstile sm;
+    sm.Start();
+
+    SECTION ("Check that the state storage is sized to the state count")
+    {
+        REQUIRE(sizeof(Turnstile::StateId) == 1);
+        REQUIRE(sizeof(Gearless::SmallestUInt<255>::type) == 1);
+        REQUIRE(sizeof(Gearless::SmallestUInt<256>::type) == 2);
+        REQUIRE(sizeof(Gearless::SmallestUInt<65536>::type) == 4);
+    }
+
+    SECTION ("Check that the current state follows the fired transitions")
+    {
+        REQUIRE(sm.IsInState<Locked>());
+        sm.ProcessEvent(Coin{1});
+        REQUIRE(sm.IsInState<Unlocked>());
+        REQUIRE(sm.GetState() == Turnstile::StateIndex<Unlocked>());
+        REQUIRE(sm.GetStateAs<unsigned>() == Turnstile::StateIndex<Unlocked>());
+    }
+
+    SECTION ("Check that a saved state can be restored into another instance")
+    {
+        sm.ProcessEvent(Kick{});
+        Turnstile other;
+        other.RestoreState(sm.GetState());
+        REQUIRE(other.IsInState<Broken>());
+    }
+}
+
+TEST_CASE("StateMachine dispatch policies agree with each other", "[StateMachine]")
+{
+    SECTION ("Check that every policy fires the first declared transition of a pair")
+    {
+        trace.clear();
+        CheckTurnstile<Gearless::LinearDispatch>();
+        CheckTurnstile<Gearless::SwitchDispatch>();
+        CheckTurnstile<Gearless::SortedDispatch>();
+        CheckTurnstile<Gearless::SparseDispatch>();
+        REQUIRE(trace == "kick;kick;kick;kick;");
+    }
+
+    SECTION ("Check every policy on small and large sub-tables")
+    {
+        CheckRing<3, Gearless::LinearDispatch>();
+        CheckRing<3, Gearless::SwitchDispatch>();
+        CheckRing<3, Gearless::DenseDispatch>();
+        CheckRing<3, Gearless::SortedDispatch>();
+        CheckRing<3, Gearless::SparseDispatch>();
+        CheckRing<20, Gearless::LinearDispatch>();
+        CheckRing<20, Gearless::SwitchDispatch>();
+        CheckRing<20, Gearless::DenseDispatch>();
+        CheckRing<20, Gearless::SortedDispatch>();
+        CheckRing<20, Gearless::SparseDispatch>();
+    }
+
+    SECTION ("Check that only events with many rows fire through an indirect call")
+    {
+        // Events with few rows must keep their actions inlined into the dispatch
+        using Small = Ring<3, Gearless::DenseDispatch>::Model;
+        using Large = Ring<20, Gearless::DenseDispatch>::Model;
+        REQUIRE(!Turnstile::Model::FiresIndirectly<Kick>::value);
+        REQUIRE(!Small::FiresIndirectly<Tick>::value);
+        REQUIRE(Small::InlineRowLimit < 20);
+        REQUIRE(Large::FiresIndirectly<Tick>::value);
+    }
+}
+
+///==============================================================
+///= Player
+///==============================================================
+// Off and On at the top level, On holding Stopped and the Playing
+// composite, which in turn holds Normal and Fast playback
+namespace
+{
+    struct PowerBtn {};
+    struct PlayBtn {};
+    struct StopBtn {};
+    struct FastBtn {};
+
+    struct Off {};
+    struct Stopped;
+    struct On { using Initial = Stopped; };
+    struct Stopped { using Parent = On; };
+    struct Normal;
+    struct Playing { using Parent = On; using Initial = Normal; };
+    struct Normal { using Parent = Playing; };
+    struct Fast { using Parent = Playing; };
+
+    void OnPowerOff(const PowerBtn&) { trace += "off;"; }
+    void OnSlowDown(const PowerBtn&) { trace += "slow;"; }
+
+    using PlayerTbl = Gearless::Packer<
+        tr< Off     , PowerBtn , On      , Gearless::NoAction                    >,
+        tr< On      , PowerBtn , Off     , Gearless::TFunct<PowerBtn, OnPowerOff> >,
+        tr< Stopped , PlayBtn  , Playing , Gearless::NoAction                    >,
+        tr< Playing , StopBtn  , Stopped , Gearless::NoAction                    >,
+        tr< Normal  , FastBtn  , Fast    , Gearless::NoAction                    >,
+        tr< Fast    , FastBtn  , Normal  , Gearless::NoAction                    >,
+        tr< Fast    , PowerBtn , Normal  , Gearless::TFunct<PowerBtn, OnSlowDown> >
+    >;
+
+    using Player = Gearless::StateMachine<Off, PlayerTbl>;
+
+    template <class Policy>
+    void CheckPlayer()
+    {
+        Gearless::StateMachine<Off, PlayerTbl, Policy> sm;
+        sm.Start();
+        sm.ProcessEvent(PowerBtn{});
+        sm.ProcessEvent(PlayBtn{});
+        sm.ProcessEvent(FastBtn{});
+        sm.ProcessEvent(PowerBtn{});
+        sm.ProcessEvent(PowerBtn{});
+        REQUIRE(sm.template IsInState<Off>());
+    }
+}
+
+TEST_CASE("StateMachine flattens composite states into its leaf states", "[StateMachine]")
+{
+    trace.clear();
+    Player sm;
+    sm.Start();
+
+    SECTION ("Check that only leaf states get an index")
+    {
+        REQUIRE(Player::StateCount == 4);
+        REQUIRE(Player::StateIndex<Off>() == 0);
+        REQUIRE(Gearless::PackSize<Player::Model::Composites>::value == 2);
+    }
+
+    SECTION ("Check that entering a composite state ends in its initial leaf")
+    {
+        sm.ProcessEvent(PowerBtn{});
+        REQUIRE(sm.IsInState<Stopped>());
+        REQUIRE(sm.IsInState<On>());
+        REQUIRE(!sm.IsInState<Playing>());
+        sm.ProcessEvent(PlayBtn{});
+        REQUIRE(sm.IsInState<Normal>());
+        REQUIRE(sm.IsInState<Playing>());
+        REQUIRE(sm.IsInState<On>());
+    }
+
+    SECTION ("Check that leaves inherit the transitions of their ancestors")
+    {
+        sm.ProcessEvent(PowerBtn{});
+        sm.ProcessEvent(PlayBtn{});
+        sm.ProcessEvent(FastBtn{});
+        sm.ProcessEvent(StopBtn{});
+        REQUIRE(sm.IsInState<Stopped>());
+        sm.ProcessEvent(PlayBtn{});
+        sm.ProcessEvent(PowerBtn{});
+        REQUIRE(sm.IsInState<Off>());
+        REQUIRE(!sm.IsInState<On>());
+        REQUIRE(trace == "off;");
+    }
+
+    SECTION ("Check that inner states override the transitions of their ancestors")
+    {
+        sm.ProcessEvent(PowerBtn{});
+        sm.ProcessEvent(PlayBtn{});
+        sm.ProcessEvent(FastBtn{});
+        sm.ProcessEvent(PowerBtn{});
+        REQUIRE(sm.IsInState<Normal>());
+        sm.ProcessEvent(PowerBtn{});
+        REQUIRE(trace == "slow;off;");
+    }
+
+    SECTION ("Check that every policy resolves the hierarchy the same way")
+    {
+        CheckPlayer<Gearless::LinearDispatch>();
+        CheckPlayer<Gearless::SwitchDispatch>();
+        CheckPlayer<Gearless::DenseDispatch>();
+        CheckPlayer<Gearless::SortedDispatch>();
+        CheckPlayer<Gearless::SparseDispatch>();
+        REQUIRE(trace == "slow;off;slow;off;slow;off;slow;off;slow;off;");
+    }
+}
+
+///==============================================================
+///= Link
+///==============================================================
+// Idle at the top level and Active holding Connecting and the
+// Connected composite, which in turn holds Ready and Busy. Every
+// state traces its entry and exit hooks
+namespace
+{
+    struct Open {};
+    struct Ack {};
+    struct Work {};
+    struct Drop {};
+    struct Close {};
+
+    struct Idle
+    {
+        static void OnEntry() { trace += "+Idle;"; }
+        static void OnExit() { trace += "-Idle;"; }
+    };
+    struct Connecting;
+    struct Active
+    {
+        using Initial = Connecting;
+        static void OnEntry() { trace += "+Active;"; }
+        static void OnExit() { trace += "-Active;"; }
+    };
+    struct Connecting
+    {
+        using Parent = Active;
+        static void OnEntry() { trace += "+Connecting;"; }
+        static void OnExit() { trace += "-Connecting;"; }
+    };
+    struct Ready;
+    struct Connected
+    {
+        using Parent = Active;
+        using Initial = Ready;
+        static void OnEntry() { trace += "+Connected;"; }
+        static void OnExit() { trace += "-Connected;"; }
+    };
+    struct Ready
+    {
+        using Parent = Connected;
+        static void OnEntry() { trace += "+Ready;"; }
+        static void OnExit() { trace += "-Ready;"; }
+    };
+    // Busy only has an exit hook
+    struct Busy
+    {
+        using Parent = Connected;
+        static void OnExit() { trace += "-Busy;"; }
+    };
+
+    void OnClose(const Close&) { trace += "close;"; }
+
+    using LinkTbl = Gearless::Packer<
+        tr< Idle       , Open  , Active     , Gearless::NoAction               >,
+        tr< Connecting , Ack   , Connected  , Gearless::NoAction               >,
+        tr< Ready      , Work  , Busy       , Gearless::NoAction               >,
+        tr< Busy       , Work  , Busy       , Gearless::NoAction               >,
+        tr< Connected  , Drop  , Connecting , Gearless::NoAction               >,
+        tr< Active     , Close , Idle       , Gearless::TFunct<Close, OnClose> >
+    >;
+
+    using Link = Gearless::StateMachine<Idle, LinkTbl>;
+}
+
+TEST_CASE("StateMachine runs entry and exit hooks along the transition path", "[StateMachine]")
+{
+    trace.clear();
+    Link sm;
+    sm.Start();
+
+    SECTION ("Check that starting enters the initial state")
+    {
+        REQUIRE(trace == "+Idle;");
+    }
+
+    SECTION ("Check that entering a composite state enters its initial children outermost first")
+    {
+        sm.ProcessEvent(Open{});
+        sm.ProcessEvent(Ack{});
+        REQUIRE(trace == "+Idle;-Idle;+Active;+Connecting;-Connecting;+Connected;+Ready;");
+    }
+
+    SECTION ("Check that only the states below the common ancestor are left and entered")
+    {
+        sm.ProcessEvent(Open{});
+        sm.ProcessEvent(Ack{});
+        trace.clear();
+        sm.ProcessEvent(Work{});
+        sm.ProcessEvent(Work{});
+        sm.ProcessEvent(Drop{});
+        REQUIRE(trace == "-Ready;-Busy;-Busy;-Connected;+Connecting;");
+    }
+
+    SECTION ("Check that exits run innermost first, before the action and the entries")
+    {
+        sm.ProcessEvent(Open{});
+        sm.ProcessEvent(Ack{});
+        sm.ProcessEvent(Work{});
+        trace.clear();
+        sm.ProcessEvent(Close{});
+        REQUIRE(trace == "-Busy;-Connected;-Active;close;+Idle;");
+        REQUIRE(sm.IsInState<Idle>());
+    }
+
+    SECTION ("Check that stopping leaves the current state up to the top level")
+    {
+        sm.ProcessEvent(Open{});
+        sm.ProcessEvent(Ack{});
+        trace.clear();
+        sm.Stop();
+        REQUIRE(trace == "-Ready;-Connected;-Active;");
+    }
+}
+
+///==============================================================
+///= Game
+///==============================================================
+// Menu and Paused at the top level and Game holding Exploring and
+// the Combat composite, which in turn holds Aiming and Firing.
+// Pausing suspends the game, resuming re-enters it through history
+namespace
+{
+    struct NewGame {};
+    struct Enemy {};
+    struct Trigger {};
+    struct Pause {};
+    struct ResumeDeep {};
+    struct ResumeShallow {};
+    struct Quit {};
+
+    struct Menu {};
+    struct Paused {};
+    struct Exploring;
+    struct Game
+    {
+        using Initial = Exploring;
+        static void OnEntry() { trace += "+Game;"; }
+    };
+    struct Exploring { using Parent = Game; };
+    struct Aiming;
+    struct Combat
+    {
+        using Parent = Game;
+        using Initial = Aiming;
+        static void OnEntry() { trace += "+Combat;"; }
+    };
+    struct Aiming
+    {
+        using Parent = Combat;
+        static void OnEntry() { trace += "+Aiming;"; }
+    };
+    struct Firing
+    {
+        using Parent = Combat;
+        static void OnEntry() { trace += "+Firing;"; }
+    };
+
+    using GameTbl = Gearless::Packer<
+        tr< Menu      , NewGame       , Game                              , Gearless::NoAction >,
+        tr< Menu      , ResumeDeep    , Gearless::DeepHistory<Game>       , Gearless::NoAction >,
+        tr< Exploring , Enemy         , Combat                            , Gearless::NoAction >,
+        tr< Aiming    , Trigger       , Firing                            , Gearless::NoAction >,
+        tr< Game      , Pause         , Paused                            , Gearless::NoAction >,
+        tr< Paused    , ResumeDeep    , Gearless::DeepHistory<Game>       , Gearless::NoAction >,
+        tr< Paused    , ResumeShallow , Gearless::ShallowHistory<Game>    , Gearless::NoAction >,
+        tr< Paused    , Quit          , Menu                              , Gearless::NoAction >
+    >;
+
+    using GameMachine = Gearless::StateMachine<Menu, GameTbl>;
+}
+
+TEST_CASE("StateMachine re-enters composite states through history", "[StateMachine]")
+{
+    trace.clear();
+    GameMachine sm;
+    sm.Start();
+
+    SECTION ("Check that each history takes an index sized to its member count")
+    {
+        REQUIRE(GameMachine::Model::HasHistory);
+        REQUIRE(sizeof(GameMachine) == 3);
+        REQUIRE(std::is_trivially_copyable<GameMachine>::value);
+    }
+
+    SECTION ("Check that history without a previous exit enters the initial leaf")
+    {
+        sm.ProcessEvent(ResumeDeep{});
+        REQUIRE(sm.IsInState<Exploring>());
+        REQUIRE(trace == "+Game;");
+    }
+
+    SECTION ("Check that deep history restores the last active leaf")
+    {
+        sm.ProcessEvent(NewGame{});
+        sm.ProcessEvent(Enemy{});
+        sm.ProcessEvent(Trigger{});
+        sm.ProcessEvent(Pause{});
+        trace.clear();
+        sm.ProcessEvent(ResumeDeep{});
+        REQUIRE(sm.IsInState<Firing>());
+        REQUIRE(trace == "+Game;+Combat;+Firing;");
+        // Pausing again records the leaf once more
+        sm.ProcessEvent(Pause{});
+        sm.ProcessEvent(ResumeDeep{});
+        REQUIRE(sm.IsInState<Firing>());
+    }
+
+    SECTION ("Check that shallow history restores the last active child by default")
+    {
+        sm.ProcessEvent(NewGame{});
+        sm.ProcessEvent(Enemy{});
+        sm.ProcessEvent(Trigger{});
+        sm.ProcessEvent(Pause{});
+        trace.clear();
+        sm.ProcessEvent(ResumeShallow{});
+        REQUIRE(sm.IsInState<Aiming>());
+        REQUIRE(trace == "+Game;+Combat;+Aiming;");
+    }
+
+    SECTION ("Check that history survives leaving through other states and is reset on start")
+    {
+        sm.ProcessEvent(NewGame{});
+        sm.ProcessEvent(Enemy{});
+        sm.ProcessEvent(Pause{});
+        sm.ProcessEvent(Quit{});
+        sm.ProcessEvent(ResumeDeep{});
+        REQUIRE(sm.IsInState<Aiming>());
+        sm.ProcessEvent(Pause{});
+        sm.Start();
+        sm.ProcessEvent(ResumeDeep{});
+        REQUIRE(sm.IsInState<Exploring>());
+    }
+}
+
+///==============================================================
+///= Valve
+///==============================================================
+// Closed and Open inside the Mounted composite. Closed only opens
+// for moderate force, while too much force jams any mounted valve
+namespace
+{
+    struct Turn { int force; };
+
+    struct Closed;
+    struct Mounted { using Initial = Closed; };
+    struct Closed { using Parent = Mounted; };
+    struct Opened { using Parent = Mounted; };
+    struct Jammed {};
+
+    bool StrongEnough(const Turn& t) { return t.force >= 5 && t.force <= 100; }
+
+    struct TooStrong
+    {
+        bool operator()(const Turn& t) const { return t.force > 100; }
+    };
+
+    void OnOpen(const Turn& t) { trace += "open" + std::to_string(t.force) + ";"; }
+
+    template <class PrevState, class Event, class NextState, typename Fn, typename Guard>
+    using gtr = Gearless::Transition<PrevState, Event, NextState, Fn, Guard>;
+
+    using ValveTbl = Gearless::Packer<
+        gtr< Closed  , Turn , Opened , Gearless::TFunct<Turn, OnOpen> , Gearless::TGuard<Turn, StrongEnough> >,
+        gtr< Opened  , Turn , Closed , Gearless::NoAction             , Gearless::NoGuard                    >,
+        gtr< Mounted , Turn , Jammed , Gearless::NoAction             , TooStrong                            >
+    >;
+
+    template <class Policy>
+    void CheckValve()
+    {
+        Gearless::StateMachine<Mounted, ValveTbl, Policy> sm;
+        sm.Start();
+        sm.ProcessEvent(Turn{1});
+        REQUIRE(sm.template IsInState<Closed>());
+        sm.ProcessEvent(Turn{10});
+        REQUIRE(sm.template IsInState<Opened>());
+        sm.ProcessEvent(Turn{500});
+        REQUIRE(sm.template IsInState<Closed>());
+        sm.ProcessEvent(Turn{500});
+        REQUIRE(sm.template IsInState<Jammed>());
+    }
+}
+
+TEST_CASE("StateMachine tries guarded transitions in declaration order", "[StateMachine]")
+{
+    trace.clear();
+
+    SECTION ("Check that a transition only fires when its guard holds")
+    {
+        Gearless::StateMachine<Mounted, ValveTbl> sm;
+        sm.Start();
+        sm.ProcessEvent(Turn{4});
+        sm.ProcessEvent(Turn{101});
+        REQUIRE(trace == "");
+        REQUIRE(sm.IsInState<Jammed>());
+    }
+
+    SECTION ("Check that failed guards fall back to the transitions of enclosing states")
+    {
+        CheckValve<Gearless::LinearDispatch>();
+        CheckValve<Gearless::SwitchDispatch>();
+        CheckValve<Gearless::DenseDispatch>();
+        CheckValve<Gearless::SortedDispatch>();
+        CheckValve<Gearless::SparseDispatch>();
+        REQUIRE(trace == "open10;open10;open10;open10;open10;");
+    }
+
+    SECTION ("Check that duplicate rows without guards still resolve to the first one")
+    {
+        Turnstile sm;
+        sm.Start();
+        sm.ProcessEvent(Kick{});
+        REQUIRE(sm.IsInState<Broken>());
+        REQUIRE(!Turnstile::Model::Actions<Kick>::hasGuards);
+    }
+}
+
+///==============================================================
+///= Printer
+///==============================================================
+// Jobs arriving while the printer is busy or offline wait until it is
+// idle again. Busy printers also hold back pings, which only the idle printer
+// answers
+namespace
+{
+    int liveJobs = 0;
+
+    struct Job
+    {
+        Job(int i) : id(i), owner("job") { ++liveJobs; }
+        Job(const Job& other) : id(other.id), owner(other.owner) { ++liveJobs; }
+        Job(Job&& other) : id(other.id), owner(std::move(other.owner)) { ++liveJobs; }
+        ~Job() { --liveJobs; }
+
+        int id;
+        std::string owner;
+    };
+
+    struct Ping {};
+    struct Done {};
+    struct Unplug {};
+    struct Plug {};
+
+    struct Waiting;
+    struct Online { using Initial = Waiting; };
+    struct Waiting { using Parent = Online; };
+    struct Printing { using Parent = Online; };
+    struct Offline {};
+
+    void OnJob(const Job& j) { trace += j.owner + std::to_string(j.id) + ";"; }
+    void OnPing(const Ping&) { trace += "pong;"; }
+
+    // Larger and more aligned than any deferred event
+    struct Bulk { double pages[8]; };
+
+    void OnBulk(const Bulk& b) { trace += "bulk" + std::to_string(static_cast<int>(b.pages[7])) + ";"; }
+
+    using PrinterTbl = Gearless::Packer<
+        tr< Waiting  , Job    , Printing , Gearless::TFunct<Job, OnJob>   >,
+        tr< Waiting  , Ping   , Waiting  , Gearless::TFunct<Ping, OnPing> >,
+        tr< Printing , Done   , Waiting  , Gearless::NoAction             >,
+        tr< Online   , Unplug , Offline  , Gearless::NoAction             >,
+        tr< Offline  , Plug   , Online   , Gearless::NoAction             >,
+        Gearless::Defer< Online   , Job  >,
+        Gearless::Defer< Printing , Ping >,
+        Gearless::Defer< Offline  , Job  >
+    >;
+
+    template <class Policy>
+    void CheckPrinter()
+    {
+        Gearless::StateMachine<Online, PrinterTbl, Policy> sm;
+        sm.Start();
+        sm.ProcessEvent(Job{1});
+        sm.ProcessEvent(Job{2});
+        sm.ProcessEvent(Ping{});
+        sm.ProcessEvent(Job{3});
+        REQUIRE(sm.GetDeferredCount() == 3);
+        sm.ProcessEvent(Unplug{});
+        REQUIRE(sm.GetDeferredCount() == 2);
+        sm.ProcessEvent(Plug{});
+        sm.ProcessEvent(Done{});
+        REQUIRE(sm.GetDeferredCount() == 0);
+        REQUIRE(sm.template IsInState<Printing>());
+    }
+}
+
+TEST_CASE("StateMachine defers events until a state handles them", "[StateMachine]")
+{
+    trace.clear();
+    using Printer = Gearless::StateMachine<Online, PrinterTbl>;
+
+    SECTION ("Check that deferred events are replayed in arrival order once the state changes")
+    {
+        Printer sm;
+        sm.Start();
+        sm.ProcessEvent(Job{1});
+        sm.ProcessEvent(Job{2});
+        sm.ProcessEvent(Job{3});
+        REQUIRE(trace == "job1;");
+        REQUIRE(sm.GetDeferredCount() == 2);
+
+        sm.ProcessEvent(Done{});
+        REQUIRE(trace == "job1;job2;");
+        REQUIRE(sm.IsInState<Printing>());
+        REQUIRE(sm.GetDeferredCount() == 1);
+
+        sm.ProcessEvent(Done{});
+        REQUIRE(trace == "job1;job2;job3;");
+        REQUIRE(sm.GetDeferredCount() == 0);
+    }
+
+    SECTION ("Check that events still deferred by the new state stay queued in order")
+    {
+        Printer sm;
+        sm.Start();
+        sm.ProcessEvent(Job{1});
+        sm.ProcessEvent(Job{2});
+        sm.ProcessEvent(Ping{});
+        sm.ProcessEvent(Job{3});
+        sm.ProcessEvent(Unplug{});
+        REQUIRE(sm.IsInState<Offline>());
+        REQUIRE(sm.GetDeferredCount() == 2);
+
+        sm.ProcessEvent(Plug{});
+        sm.ProcessEvent(Done{});
+        REQUIRE(trace == "job1;job2;job3;");
+    }
+
+    SECTION ("Check that a state's own transition takes precedence over an inherited deferral")
+    {
+        Printer sm;
+        sm.Start();
+        sm.ProcessEvent(Ping{});
+        sm.ProcessEvent(Job{1});
+        sm.ProcessEvent(Ping{});
+        REQUIRE(trace == "pong;job1;");
+        sm.ProcessEvent(Done{});
+        REQUIRE(trace == "pong;job1;pong;");
+    }
+
+    SECTION ("Check that all dispatch policies defer the same events")
+    {
+        CheckPrinter<Gearless::LinearDispatch>();
+        CheckPrinter<Gearless::SwitchDispatch>();
+        CheckPrinter<Gearless::DenseDispatch>();
+        CheckPrinter<Gearless::SortedDispatch>();
+        CheckPrinter<Gearless::SparseDispatch>();
+    }
+
+    SECTION ("Check that queued events are destroyed on restart and destruction")
+    {
+        {
+            Gearless::StateMachine<Online, PrinterTbl, Gearless::DenseDispatch, 4> sm;
+            sm.Start();
+            for (int i = 0; i < 5; ++i)
+                sm.ProcessEvent(Job{i});
+            REQUIRE(liveJobs == 4);
+            sm.Start();
+            REQUIRE(liveJobs == 0);
+            for (int i = 0; i < 3; ++i)
+                sm.ProcessEvent(Job{i});
+        }
+        REQUIRE(liveJobs == 0);
+    }
+
+    SECTION ("Check that only a change of state replays the queue, not a self transition")
+    {
+        using SelfTbl = Gearless::Packer<
+            tr< Waiting  , Job  , Printing , Gearless::TFunct<Job, OnJob>   >,
+            tr< Printing , Ping , Printing , Gearless::TFunct<Ping, OnPing> >,
+            tr< Printing , Done , Waiting  , Gearless::NoAction             >,
+            Gearless::Defer< Printing , Job >
+        >;
+        Gearless::StateMachine<Waiting, SelfTbl> sm;
+        sm.Start();
+        sm.ProcessEvent(Job{1});
+        sm.ProcessEvent(Job{2});
+        REQUIRE(sm.ProcessEvent(Ping{}) == Gearless::EventResult::Handled);
+        REQUIRE(trace == "job1;pong;");
+        REQUIRE(sm.GetDeferredCount() == 1);
+        sm.ProcessEvent(Done{});
+        REQUIRE(trace == "job1;pong;job2;");
+        REQUIRE(sm.GetDeferredCount() == 0);
+    }
+
+    SECTION ("Check that events larger than every deferred one can still be dispatched")
+    {
+        using BulkTbl = Gearless::Packer<
+            tr< Waiting  , Bulk , Printing , Gearless::TFunct<Bulk, OnBulk> >,
+            tr< Waiting  , Ping , Waiting  , Gearless::TFunct<Ping, OnPing> >,
+            tr< Printing , Done , Waiting  , Gearless::NoAction             >,
+            Gearless::Defer< Printing , Ping >
+        >;
+        Gearless::StateMachine<Waiting, BulkTbl> sm;
+        sm.Start();
+        Bulk bulk = {};
+        bulk.pages[7] = 7;
+        REQUIRE(sm.ProcessEvent(bulk) == Gearless::EventResult::Handled);
+        REQUIRE(sm.ProcessEvent(Ping{}) == Gearless::EventResult::Deferred);
+        REQUIRE(sm.ProcessEvent(bulk) == Gearless::EventResult::Unhandled);
+        REQUIRE(sm.ProcessEvent(Done{}) == Gearless::EventResult::Handled);
+        REQUIRE(trace == "bulk7;pong;");
+        REQUIRE(sm.GetDeferredCount() == 0);
+    }
+
+    SECTION ("Check that machines without deferrals carry no queue")
+    {
+        REQUIRE(sizeof(Turnstile) == 1);
+        REQUIRE(!Turnstile::Model::HasDeferrals);
+        REQUIRE(Printer::Model::HasDeferrals);
+    }
+}
+
+///==============================================================
+///= Observers
+///==============================================================
+namespace
+{
+    // Records every notification in the shared trace
+    template <class Model>
+    struct TracingObserver
+    {
+        using StateId = typename Model::StateId;
+
+        template <class Event>
+        void OnDispatch(StateId) {}
+
+        template <class Event>
+        void OnTransition(StateId prev, StateId next)
+        {
+            trace += "fire" + std::to_string(prev) + ">" + std::to_string(next) + ";";
+        }
+
+        template <class Event>
+        void OnUnhandled(StateId state) { trace += "drop" + std::to_string(state) + ";"; }
+
+        template <class Event>
+        void OnDeferred(StateId state) { trace += "defer" + std::to_string(state) + ";"; }
+
+        void OnStateEntered(StateId state) { trace += "enter" + std::to_string(state) + ";"; }
+        void OnStateLeft(StateId state) { trace += "leave" + std::to_string(state) + ";"; }
+    };
+
+    template <class InitState, class TransitionsPack, template <class> class ObserverPolicy>
+    using Observed = Gearless::StateMachine<InitState, TransitionsPack, Gearless::DenseDispatch, 16, ObserverPolicy>;
+}
+
+TEST_CASE("StateMachine reports dispatched events to its observer", "[StateMachine]")
+{
+    trace.clear();
+
+    SECTION ("Check that the default observer costs nothing")
+    {
+        REQUIRE(sizeof(Turnstile) == 1);
+        REQUIRE(std::is_empty<Turnstile::Observer>::value);
+    }
+
+    SECTION ("Check that transitions report the state left, themselves and the state entered")
+    {
+        Observed<Locked, RepairTbl, TracingObserver> sm;
+        sm.Start();
+        sm.ProcessEvent(Kick{});
+        sm.ProcessEvent(Push{});
+        sm.ProcessEvent(Coin{1});
+        sm.Stop();
+        REQUIRE(trace == "enter0;kick;leave0;fire0>1;enter1;drop1;drop1;leave1;");
+    }
+
+    SECTION ("Check that replayed deferred events are reported like the others")
+    {
+        Observed<Online, PrinterTbl, TracingObserver> sm;
+        sm.Start();
+        sm.ProcessEvent(Job{1});
+        trace.clear();
+        sm.ProcessEvent(Job{2});
+        sm.ProcessEvent(Job{3});
+        sm.ProcessEvent(Done{});
+        REQUIRE(trace == "defer1;defer1;leave1;fire1>0;enter0;job2;leave0;fire0>1;enter1;defer1;");
+    }
+
+    SECTION ("Check that deferred events the full queue drops are reported once, as unhandled")
+    {
+        Gearless::StateMachine<Online, PrinterTbl, Gearless::DenseDispatch, 2, TracingObserver> sm;
+        sm.Start();
+        sm.ProcessEvent(Job{1});
+        trace.clear();
+        for (int i = 2; i < 5; ++i)
+            REQUIRE(sm.ProcessEvent(Job{i}) != Gearless::EventResult::Handled);
+        REQUIRE(trace == "defer1;defer1;drop1;");
+
+        Gearless::StateMachine<Online, PrinterTbl, Gearless::DenseDispatch, 2, Gearless::CountingObserver> counted;
+        counted.Start();
+        for (int i = 1; i < 6; ++i)
+            counted.ProcessEvent(Job{i});
+        REQUIRE(counted.GetObserver().Deferred() == 2);
+        REQUIRE(counted.GetObserver().Unhandled() == 2);
+        counted.ProcessEvent(Done{});
+        REQUIRE(counted.GetObserver().Deferred() == 3);
+        REQUIRE(counted.GetObserver().Unhandled() == 2);
+    }
+
+    SECTION ("Check that the counting observer counts hits per state and event")
+    {
+        using Counted = Observed<Locked, RepairTbl, Gearless::CountingObserver>;
+        Counted sm;
+        sm.Start();
+        for (int i = 0; i < 3; ++i)
+        {
+            sm.ProcessEvent(Coin{i});
+            sm.ProcessEvent(Kick{});
+            sm.ProcessEvent(Kick{});
+        }
+        sm.ProcessEvent(Push{});
+
+        const Counted::Observer& counts = sm.GetObserver();
+        const std::uint64_t lockedKicks = counts.Hits<Locked, Kick>();
+        const std::uint64_t brokenKicks = counts.Hits<Broken, Kick>();
+        const std::uint64_t lockedCoins = counts.Hits<Locked, Coin>();
+        const std::uint64_t brokenCoins = counts.Hits<Broken, Coin>();
+        REQUIRE(lockedKicks == 3);
+        REQUIRE(brokenKicks == 3);
+        REQUIRE(lockedCoins == 3);
+        REQUIRE(brokenCoins == 0);
+        REQUIRE(counts.Hits(Counted::StateIndex<Locked>(), Counted::EventIndex<Kick>()) == 3);
+        REQUIRE(counts.Entries(Counted::StateIndex<Locked>()) == 7);
+        REQUIRE(counts.Unhandled() == 1);
+
+        sm.GetObserver().Reset();
+        REQUIRE(counts.Hits(Counted::StateIndex<Locked>(), Counted::EventIndex<Kick>()) == 0);
+    }
+}
+
+///==============================================================
+///= Unhandled events
+///==============================================================
+namespace
+{
+    template <class InitState, class TransitionsPack, template <class> class UnhandledPolicy>
+    using Strict = Gearless::StateMachine<InitState, TransitionsPack, Gearless::DenseDispatch, 16,
+                                          Gearless::NullObserver, UnhandledPolicy>;
+
+    void OnDropped(void* context, std::uint8_t state, std::size_t event)
+    {
+        static_cast<std::string*>(context)->append(std::to_string(state) + ":" + std::to_string(event) + ";");
+    }
+}
+
+TEST_CASE("StateMachine reports the outcome of every event", "[StateMachine]")
+{
+    using Gearless::EventResult;
+
+    SECTION ("Check that ProcessEvent returns whether the event was handled, unhandled or deferred")
+    {
+        Turnstile sm;
+        sm.Start();
+        REQUIRE(sm.ProcessEvent(Push{}) == EventResult::Unhandled);
+        REQUIRE(sm.ProcessEvent(Coin{1}) == EventResult::Handled);
+        REQUIRE(sm.ProcessEvent(Coin{2}) == EventResult::Unhandled);
+
+        Gearless::StateMachine<Online, PrinterTbl> printer;
+        printer.Start();
+        REQUIRE(printer.ProcessEvent(Job{1}) == EventResult::Handled);
+        REQUIRE(printer.ProcessEvent(Job{2}) == EventResult::Deferred);
+        REQUIRE(printer.ProcessEvent(Done{}) == EventResult::Handled);
+        REQUIRE(printer.GetDeferredCount() == 0);
+    }
+
+    SECTION ("Check that deferred events the full queue cannot take are reported as unhandled")
+    {
+        Gearless::StateMachine<Online, PrinterTbl, Gearless::DenseDispatch, 2,
+                               Gearless::CountingObserver, Gearless::CountUnhandled> sm;
+        sm.Start();
+        REQUIRE(sm.ProcessEvent(Job{1}) == EventResult::Handled);
+        REQUIRE(sm.ProcessEvent(Job{2}) == EventResult::Deferred);
+        REQUIRE(sm.ProcessEvent(Job{3}) == EventResult::Deferred);
+        REQUIRE(sm.ProcessEvent(Job{4}) == EventResult::Unhandled);
+        REQUIRE(sm.ProcessEvent(Job{5}) == EventResult::Unhandled);
+        REQUIRE(sm.GetDeferredCount() == 2);
+        REQUIRE(sm.GetUnhandledPolicy().GetUnhandledCount() == 2);
+        REQUIRE(sm.GetObserver().Unhandled() == 2);
+        REQUIRE(sm.GetObserver().Deferred() == 2);
+
+        sm.ProcessEvent(Done{});
+        sm.ProcessEvent(Done{});
+        sm.ProcessEvent(Done{});
+        REQUIRE(sm.GetDeferredCount() == 0);
+        REQUIRE(sm.IsInState<Waiting>());
+        REQUIRE(sm.GetUnhandledPolicy().GetUnhandledCount() == 2);
+    }
+
+    SECTION ("Check that the default policy adds nothing to the machine")
+    {
+        REQUIRE(std::is_empty<Turnstile::Unhandled>::value);
+        REQUIRE(sizeof(Strict<Locked, TurnstileTbl, Gearless::AssertOnUnhandled>) == 1);
+    }
+
+    SECTION ("Check that the counting policy counts events no transition accepted")
+    {
+        Strict<Locked, RepairTbl, Gearless::CountUnhandled> sm;
+        sm.Start();
+        sm.ProcessEvent(Push{});
+        sm.ProcessEvent(Coin{1});
+        sm.ProcessEvent(Kick{});
+        sm.ProcessEvent(Coin{2});
+        REQUIRE(sm.GetUnhandledPolicy().GetUnhandledCount() == 2);
+        sm.GetUnhandledPolicy().Reset();
+        REQUIRE(sm.GetUnhandledPolicy().GetUnhandledCount() == 0);
+    }
+
+    SECTION ("Check that the callback policy passes the state and event indices")
+    {
+        using Machine = Strict<Locked, RepairTbl, Gearless::CallbackOnUnhandled>;
+        Machine sm;
+        sm.Start();
+        sm.ProcessEvent(Push{});
+
+        std::string dropped;
+        sm.GetUnhandledPolicy().SetUnhandledCallback(OnDropped, &dropped);
+        sm.ProcessEvent(Kick{});
+        sm.ProcessEvent(Coin{1});
+        sm.ProcessEvent(Push{});
+        REQUIRE(dropped == std::to_string(Machine::StateIndex<Broken>()) + ":" + std::to_string(Machine::EventIndex<Coin>()) + ";" +
+                           std::to_string(Machine::StateIndex<Broken>()) + ":" + std::to_string(Machine::EventCount) + ";");
+    }
+
+    SECTION ("Check that the asserting policy stays quiet while every event is handled")
+    {
+        Strict<Locked, RepairTbl, Gearless::AssertOnUnhandled> sm;
+        sm.Start();
+        REQUIRE(sm.ProcessEvent(Kick{}) == EventResult::Handled);
+        REQUIRE(sm.ProcessEvent(Kick{}) == EventResult::Handled);
+        REQUIRE(sm.ProcessEvent(Coin{1}) == EventResult::Handled);
+    }
+}
@@ -0,0 +1,221 @@
+/*********************************************************************************************************************/
+/*                                                  /===-_---~~~~~~~~~------____                                     */
+/*                                                 |===-~___                _,-'                                     */
+/*                  -==\\                         `//~\\   ~~~~`---.___.-~~                                          */
+/*              ______-==|                         | |  \\           _-~`                                            */
+/*        __--~~~  ,-/-==\\                        | |   `\        ,'                                                */
+/*     _-~       /'    |  \\                      / /      \      /                                                  */
+/*   .'        /       |   \\                   /' /        \   /'                                                   */
+/*  /  ____  /         |    \`\.__/-~~ ~ \ _ _/'  /          \/'                                                     */
+/* /-'~    ~~~~~---__  |     ~-/~         ( )   /'        _--~`                                                      */
+/*                   \_|      /        _)   ;  ),   __--~~                                                           */
+/*                     '~~--_/      _-~/-  / \   '-~ \                                                               */
+/*                    {\__--_/}    / \\_>- )<__\      \                                                              */
+/*                    /'   (_/  _-~  | |__>--<__|      |                                                             */
+/*                   |0  0 _/) )-~     | |__>--<__|     |                                                            */
+/*                   / /~ ,_/       / /__>---<__/      |                                                             */
+/*                  o o _//        /-~_>---<__-~      /                                                              */
+/*                  (^(~          /~_>---<__-      _-~                                                               */
+/*                 ,/|           /__>--<__/     _-~                                                                  */
+/*              ,//('(          |__>--<__|     /                  .----_                                             */
+/*             ( ( '))          |__>--<__|    |                 /' _---_~\                                           */
+/*          `-)) )) (           |__>--<__|    |               /'  /     ~\`\                                         */
+/*         ,/,'//( (             \__>--<__\    \            /'  //        ||                                         */
+/*       ,( ( ((, ))              ~-__>--<_~-_  ~--____---~' _/'/        /'                                          */
+/*     `~/  )` ) ,/|                 ~-_~>--<_/-__       __-~ _/                                                     */
+/*   ._-~//( )/ )) `                    ~~-'_/_/ /~~~~~~~__--~                                                       */
+/*    ;'( ')/ ,)(                              ~~~~~~~~~~                                                            */
+/*   ' ') '( (/                                                                                                      */
+/*     '   '  `                                                                                                      */
+/*********************************************************************************************************************/
+#define CATCH_CONFIG_MAIN
+#include <catch.hpp>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+#include <Gearless/StateMachine.hpp>
+#include <Gearless/TraceRing.hpp>
+
+///==============================================================
+///= Ring
+///==============================================================
+TEST_CASE("TraceRing keeps the latest records of its thread", "[TraceRing]")
+{
+    using Gearless::EventResult;
+    using Gearless::TraceRing;
+    using Gearless::TraceRecord;
+
+    TraceRing& ring = TraceRing::ForThisThread();
+    const std::size_t capacity = TraceRing::Capacity;
+    const std::size_t recordWords = TraceRing::RecordWords;
+
+    SECTION ("Check that a thread always gets the same ring")
+    {
+        REQUIRE(&TraceRing::ForThisThread() == &ring);
+    }
+
+    SECTION ("Check that the fields survive encoding")
+    {
+        ring.Write(123456789012345ull, 0xDEADBEEF, 7, 0xFFFE, 0xCAFEBABE, EventResult::Deferred);
+        const std::vector<TraceRecord> records = ring.Snapshot();
+        REQUIRE(!records.empty());
+        const TraceRecord& last = records.back();
+        REQUIRE(last.timestamp == 123456789012345ull);
+        REQUIRE(last.machine == 0xDEADBEEF);
+        REQUIRE(last.state == 7);
+        REQUIRE(last.event == 0xFFFE);
+        REQUIRE(last.next == 0xCAFEBABE);
+        REQUIRE(last.result == EventResult::Deferred);
+    }
+
+    SECTION ("Check that the oldest records are overwritten once the ring is full")
+    {
+        for (std::uint64_t i = 0; i < capacity + 10; ++i)
+            ring.Write(i, 1, 0, 0, 0, EventResult::Handled);
+
+        const std::vector<TraceRecord> records = ring.Snapshot();
+        REQUIRE(records.size() == capacity - 1);
+        bool ordered = true;
+        for (std::size_t i = 0; i < records.size(); ++i)
+            ordered = ordered && records[i].timestamp == 11 + i;
+        REQUIRE(ordered);
+    }
+
+    SECTION ("Check that a raw snapshot copies the latest records and decodes them later")
+    {
+        const std::uint64_t written = ring.Written();
+        for (std::uint64_t i = 0; i < 5; ++i)
+            ring.Write(i, 2, 0, 0, 0, EventResult::Unhandled);
+        REQUIRE(ring.Written() == written + 5);
+
+        std::uint64_t words[3 * 3];
+        REQUIRE(ring.Snapshot(words, 3) == 3);
+        REQUIRE(TraceRing::Decode(&words[0]).timestamp == 2);
+        REQUIRE(TraceRing::Decode(&words[recordWords]).timestamp == 3);
+        REQUIRE(TraceRing::Decode(&words[2 * recordWords]).timestamp == 4);
+        REQUIRE(TraceRing::Decode(&words[2 * recordWords]).result == EventResult::Unhandled);
+    }
+}
+
+TEST_CASE("TraceRing can be read while its thread writes it", "[TraceRing]")
+{
+    using Gearless::EventResult;
+    using Gearless::TraceRing;
+    using Gearless::TraceRecord;
+
+    const std::uint32_t machine = 0x5EED;
+    std::atomic<const TraceRing*> shared(nullptr);
+    std::atomic<bool> done(false);
+
+    std::thread writer([&]()
+    {
+        TraceRing& ring = TraceRing::ForThisThread();
+        shared.store(&ring, std::memory_order_release);
+        for (std::uint64_t i = 0; i < 200000; ++i)
+            ring.Write(i, machine, static_cast<std::uint32_t>(i), 0, static_cast<std::uint32_t>(i + 1), EventResult::Handled);
+        done.store(true, std::memory_order_release);
+    });
+
+    while (!shared.load(std::memory_order_acquire))
+        std::this_thread::yield();
+    const TraceRing& ring = *shared.load(std::memory_order_acquire);
+
+    bool consistent = true;
+    while (!done.load(std::memory_order_acquire))
+    {
+        const std::vector<TraceRecord> records = ring.Snapshot();
+        for (std::size_t i = 0; i < records.size(); ++i)
+        {
+            const TraceRecord& r = records[i];
+            consistent = consistent && r.machine == machine && r.state == r.timestamp && r.next == r.timestamp + 1 &&
+                         (i == 0 || r.timestamp == records[i - 1].timestamp + 1);
+        }
+    }
+    writer.join();
+    REQUIRE(consistent);
+    REQUIRE(ring.Written() >= 200000);
+
+    SECTION ("Check that the ring of an exited thread is still listed and handed over to the next one")
+    {
+        bool listed = false;
+        TraceRing::ForEach([&](const TraceRing& r) { listed = listed || &r == &ring; });
+        REQUIRE(listed);
+
+        const TraceRing* reused = nullptr;
+        std::thread([&]() { reused = &TraceRing::ForThisThread(); }).join();
+        REQUIRE(reused == &ring);
+    }
+}
+
+///==============================================================
+///= Observer
+///==============================================================
+namespace
+{
+    struct Flip {};
+    struct Flop {};
+    struct Stray {};
+
+    struct Up {};
+    struct Down {};
+
+    template <class PrevState, class Event, class NextState>
+    using tr = Gearless::Transition<PrevState, Event, NextState, Gearless::NoAction>;
+
+    using SwitchTbl = Gearless::Packer<
+        tr< Down , Flip , Up   >,
+        tr< Up   , Flop , Down >
+    >;
+
+    using Switch = Gearless::StateMachine<Down, SwitchTbl, Gearless::DenseDispatch, 16, Gearless::TraceObserver>;
+    using Model = Switch::Model;
+}
+
+TEST_CASE("TraceObserver writes every dispatched event into the ring of its thread", "[TraceRing]")
+{
+    using Gearless::EventResult;
+    using Gearless::TraceRecord;
+
+    Switch first;
+    Switch second;
+    REQUIRE(first.GetObserver().GetMachineId() != second.GetObserver().GetMachineId());
+
+    first.GetObserver().SetMachineId(42);
+    first.Start();
+    const std::uint64_t written = Gearless::TraceRing::ForThisThread().Written();
+    first.ProcessEvent(Flip{});
+    first.ProcessEvent(Flip{});
+    first.ProcessEvent(Stray{});
+    first.ProcessEvent(Flop{});
+    REQUIRE(Gearless::TraceRing::ForThisThread().Written() == written + 4);
+
+    const std::vector<TraceRecord> records = Gearless::TraceRing::ForThisThread().Snapshot();
+    REQUIRE(records.size() >= 4);
+    const TraceRecord* r = &records[records.size() - 4];
+
+    const std::uint32_t down = Model::StateIndex<Down>();
+    const std::uint32_t up = Model::StateIndex<Up>();
+    const std::uint16_t flip = Model::EventIndex<Flip>();
+    const std::uint16_t flop = Model::EventIndex<Flop>();
+    const std::uint16_t unknown = Gearless::TraceRecord::UnknownEvent;
+
+    REQUIRE(r[0].machine == 42);
+    REQUIRE(r[0].state == down);
+    REQUIRE(r[0].event == flip);
+    REQUIRE(r[0].next == up);
+    REQUIRE(r[0].result == EventResult::Handled);
+
+    REQUIRE(r[1].state == up);
+    REQUIRE(r[1].event == flip);
+    REQUIRE(r[1].next == up);
+    REQUIRE(r[1].result == EventResult::Unhandled);
+
+    REQUIRE(r[2].event == unknown);
+    REQUIRE(r[2].result == EventResult::Unhandled);
+
+    REQUIRE(r[3].state == up);
+    REQUIRE(r[3].event == flop);
+    REQUIRE(r[3].next == down);
+    REQUIRE(r[3].timestamp >= r[0].timestamp);
+}
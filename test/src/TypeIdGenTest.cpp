@@ -1,5 +1,8 @@
 #define CATCH_CONFIG_MAIN
 #include <catch.hpp>
+#include <algorithm>
+#include <thread>
+#include <vector>
 #include <Gearless/Gearless.hpp>
 
 struct ABaseType
@@ -49,3 +52,77 @@ TEST_CASE("TypeId Generator should work with all possible arguments for the same
         REQUIRE(Gearless::GetTypeId<ABaseType>() == Gearless::GetTypeId<const ABaseType&&>());
     }
 }
+
+template <int N>
+struct ATaggedType {};
+
+template <int... Ns>
+std::vector<Gearless::TypeId> GetTaggedTypeIds()
+{
+    return std::vector<Gearless::TypeId>{ Gearless::GetTypeId<ATaggedType<Ns>>()... };
+}
+
+TEST_CASE("TypeId Generator should hand out distinct ids when types are first used concurrently", "[TypeIdGen]")
+{
+    std::vector<std::vector<Gearless::TypeId>> ids(4);
+    std::atomic<int> ready(0);
+    auto worker = [&ready](std::vector<Gearless::TypeId>& out, std::vector<Gearless::TypeId> (*gen)())
+    {
+        // Line all threads up so that they race for their first ids
+        ++ready;
+        while (ready.load() < 4) {}
+        out = gen();
+    };
+
+    std::vector<std::thread> threads;
+    threads.emplace_back(worker, std::ref(ids[0]), &GetTaggedTypeIds<0, 1, 2, 3, 4, 5, 6, 7>);
+    threads.emplace_back(worker, std::ref(ids[1]), &GetTaggedTypeIds<8, 9, 10, 11, 12, 13, 14, 15>);
+    threads.emplace_back(worker, std::ref(ids[2]), &GetTaggedTypeIds<16, 17, 18, 19, 20, 21, 22, 23>);
+    threads.emplace_back(worker, std::ref(ids[3]), &GetTaggedTypeIds<0, 8, 16, 24, 25, 26, 27, 28>);
+    for (std::thread& t : threads)
+        t.join();
+
+    SECTION ("Check that ids of distinct types never collide")
+    {
+        std::vector<Gearless::TypeId> all;
+        for (int i = 0; i < 3; ++i)
+            all.insert(all.end(), ids[i].begin(), ids[i].end());
+        std::sort(all.begin(), all.end());
+        REQUIRE(std::unique(all.begin(), all.end()) == all.end());
+    }
+
+    SECTION ("Check that every thread observed the same id for a shared type")
+    {
+        REQUIRE(ids[3][0] == ids[0][0]);
+        REQUIRE(ids[3][1] == ids[1][0]);
+        REQUIRE(ids[3][2] == ids[2][0]);
+        REQUIRE(ids[3][3] == Gearless::GetTypeId<ATaggedType<24>>());
+    }
+}
+
+using ATypeSet = Gearless::TypeSet<ABaseType, ADerivedType, const ABaseType&, int>::type;
+
+template <class T>
+using ATypeIndex = Gearless::TypeIndex<T, ATypeSet>;
+
+TEST_CASE("TypeIndex should give dense compile time indices within a type set", "[TypeIndex]")
+{
+    SECTION ("Check that duplicate types are collapsed in the type set")
+    {
+        REQUIRE(Gearless::PackSize<ATypeSet>::value == 3);
+    }
+
+    SECTION ("Check that indices follow the first occurrence order of the types")
+    {
+        static_assert(ATypeIndex<ABaseType>::value == 0, "TypeIndex must be a constant expression");
+        REQUIRE(ATypeIndex<ABaseType>::value == 0);
+        REQUIRE(ATypeIndex<ADerivedType>::value == 1);
+        REQUIRE(ATypeIndex<int>::value == 2);
+    }
+
+    SECTION ("Check that indices ignore const and reference identifiers")
+    {
+        REQUIRE(ATypeIndex<const ADerivedType&>::value == ATypeIndex<ADerivedType>::value);
+        REQUIRE(ATypeIndex<ADerivedType&&>::value == ATypeIndex<ADerivedType>::value);
+    }
+}